@@ -0,0 +1,46 @@
+#!/bin/sh
+# Replaces a stage of a running chain with "power" through the control fifo, and then replaces that again.
+# The power module reports to its own fifo, which has to stay open for as long as the module runs, and be closed
+# once it is replaced. The chain has to put out as much as it does without the replacements, and the reports have to
+# keep coming.
+CSDR=${CSDR:-csdr}
+DIR=$(mktemp -d)
+trap 'rm -rf $DIR' EXIT
+mkfifo $DIR/control $DIR/power
+
+# 20 blocks of 100000 complex samples, fed slowly enough for the replacements to happen in between
+BLOCKS=20
+head -c $(( BLOCKS * 200000 )) /dev/urandom | $CSDR convert -i char -o float > $DIR/input
+CHAIN="shift 0.1 | shift 0 | shift -0.1"
+# shift only works on whole blocks, so compare with what the chain puts out without any replacements
+EXPECTED=$(( $($CSDR chain "$CHAIN" < $DIR/input | wc -c) / 8 ))
+(
+    for i in $(seq 0 $(( BLOCKS - 1 ))); do
+        dd if=$DIR/input bs=800000 skip=$i count=1 2>/dev/null
+        sleep 0.1
+    done
+) | $CSDR chain --fifo $DIR/control "$CHAIN" > $DIR/output &
+PID=$!
+
+cat $DIR/power > $DIR/reports &
+READER=$!
+
+exec 3>$DIR/control
+sleep 0.5
+echo "replace 2 power -o $DIR/power 1024 1 10" >&3
+sleep 0.5
+# deletes the power module, which closes its fifo
+echo "replace 2 shift 0" >&3
+wait $READER
+wait $PID
+RESULT=$?
+exec 3>&-
+
+SAMPLES=$(( $(wc -c < $DIR/output) / 8 ))
+REPORTS=$(wc -l < $DIR/reports)
+echo "chain exited with $RESULT, $SAMPLES of $EXPECTED samples out, $REPORTS power reports"
+if [ $RESULT -ne 0 ] || [ $SAMPLES -ne $EXPECTED ] || [ $REPORTS -eq 0 ]; then
+    echo "FAILED"
+    exit 1
+fi
+echo "OK"
@@ -44,6 +44,7 @@ namespace Csdr {
     class Agc: public UntypedAgc, public AnyLengthModule<T, T> {
         public:
             void process(T* input, T* output, size_t work_size) override;
+            bool supportsInPlace() override { return true; }
 
             void setReference(float reference) override;
             void setAttack(float attack_rate) override;
@@ -71,7 +72,8 @@ namespace Csdr {
             float xk = 0;
             float vk = 0;
             // readahead 128 samples
-            T last_samples[128];
+            T last_samples[128] = {};
+            size_t last_samples_pos = 0;
             float env_detect = 0;
             float target_gain = 1;
     };
@@ -20,6 +20,7 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include "module.hpp"
+#include "threadpolicy.hpp"
 #include <thread>
 #include <mutex>
 
@@ -27,7 +28,7 @@ namespace Csdr {
 
     class AsyncRunner {
         public:
-            explicit AsyncRunner(UntypedModule* module);
+            explicit AsyncRunner(UntypedModule* module, ThreadPolicy policy = ThreadPolicy());
             ~AsyncRunner();
             void stop();
             bool isRunning() const;
@@ -35,6 +36,7 @@ namespace Csdr {
             void loop();
             bool run = true;
             UntypedModule*  module;
+            ThreadPolicy policy;
             std::mutex stateMutex;
             // any members that will be used by the thread must come above the thread itself in the member list here
             // C++ initializes the member variables in this order, so this ensures that members are available as soon
@@ -0,0 +1,60 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+
+namespace Csdr {
+
+    // decides how many samples a module processes per call.
+    // an adaptive policy grows the block size while throughput improves, as long as processing a single block stays
+    // within the latency budget.
+    class BlockSizePolicy {
+        public:
+            // a fixed block size
+            explicit BlockSizePolicy(size_t blockSize = 1024);
+            // an adaptive block size between minimum and maximum. latency is the budget per block in microseconds.
+            BlockSizePolicy(size_t minimum, size_t maximum, uint64_t latency);
+            size_t getBlockSize() const;
+            size_t getMinimum() const;
+            size_t getMaximum() const;
+            uint64_t getLatency() const;
+            bool isAdaptive() const;
+            // feeds the tuner with the time it took to process a number of samples
+            void record(size_t samples, uint64_t nanoseconds);
+        private:
+            void evaluate();
+            size_t minimum;
+            size_t maximum;
+            uint64_t latency;
+            size_t current;
+            // block size before the last increase, to return to if it did not pay off
+            size_t previous;
+            bool settled;
+            // measurements for the current block size
+            unsigned int calls = 0;
+            uint64_t samples = 0;
+            uint64_t nanoseconds = 0;
+            double lastThroughput = 0;
+    };
+
+}
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "writer.hpp"
+#include "ringbuffer.hpp"
+#include "iouring.hpp"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Csdr {
+
+    // what to do with new output when the consumer cannot keep up
+    enum class OverflowPolicy {BLOCK, DROP};
+
+    // coalesces small writes to a file descriptor into larger ones. pending output is written once flushSize samples
+    // have accumulated, when it has been waiting for flushInterval, or on flush().
+    // with an I/O thread, processing only has to wait for the consumer once the internal buffer is full, and the
+    // overflow policy decides whether it waits or the new output is discarded. without one, the time limit is only
+    // checked when new output arrives. the I/O thread can use io_uring, with the buffer and the file descriptor
+    // registered with the kernel.
+    template <typename T>
+    class BufferedWriter: public Writer<T> {
+        public:
+            BufferedWriter(int fd, size_t flushSize, std::chrono::milliseconds flushInterval, bool threaded = true, OverflowPolicy overflow = OverflowPolicy::BLOCK, bool ioUring = false);
+            // writes out everything that is still pending
+            ~BufferedWriter() override;
+            size_t writeable() override;
+            T* getWritePointer() override;
+            void advance(size_t how_much) override;
+            uint64_t getWriteCount() override;
+            void flush() override;
+            bool isClosed() override;
+            // number of samples that were discarded with OverflowPolicy::DROP
+            uint64_t getDroppedSamples();
+        private:
+            void loop();
+            void writeOut(size_t how_much);
+            int fd;
+            size_t flushSize;
+            std::chrono::milliseconds flushInterval;
+            OverflowPolicy overflow;
+            Ringbuffer<T>* buffer;
+            RingbufferReader<T>* reader;
+            IoUring* uring = nullptr;
+            std::chrono::steady_clock::time_point oldest;
+            std::atomic<uint64_t> write_count{0};
+            std::atomic<uint64_t> dropped{0};
+            std::atomic<bool> closed{false};
+            bool run = true;
+            bool flushRequested = false;
+            std::mutex stateMutex;
+            std::condition_variable stateCondition;
+            std::condition_variable flushCondition;
+            // must be the last member, see AsyncRunner
+            std::thread thread;
+    };
+
+}
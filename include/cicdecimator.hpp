@@ -0,0 +1,83 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "module.hpp"
+#include "complex.hpp"
+#include "window.hpp"
+#include "fir.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace Csdr {
+
+    // taps that undo the passband droop of a CIC decimator, up to passband (relative to the CIC output rate).
+    // everything above the passband is rejected.
+    class CicCompensationTapGenerator: public TapGenerator<float> {
+        public:
+            CicCompensationTapGenerator(unsigned int ratio, unsigned int order, float passband, Window* window);
+            float* generateTaps(size_t length) override;
+        protected:
+            std::string describe() override;
+        private:
+            unsigned int ratio;
+            unsigned int order;
+            float passband;
+    };
+
+    // cascaded integrator-comb decimator: decimates by ratio with order integrators at the input rate and order
+    // combs at the output rate, without a single multiplication per input sample. meant as the first stage for very
+    // high input rates, in front of FirDecimate or MultistageDecimator.
+    // the integrators work on wrapping 64 bit integers, so they never lose precision. float input is converted to
+    // fixed point for that.
+    // the output is normalized to unity gain at DC, and optionally runs through a compensation FIR.
+    template <typename T>
+    class CicDecimator: public Module<T, complex<float>> {
+        public:
+            // compensationTaps of 0 disables the compensation FIR
+            CicDecimator(unsigned int ratio, unsigned int order, float passband = 0.25f, size_t compensationTaps = 31);
+            ~CicDecimator() override;
+            bool canProcess() override;
+            void process() override;
+        private:
+            // CIC output that can be produced right now
+            size_t cicSpace();
+            // compensated output that can be produced right now
+            size_t compensationOutput();
+            unsigned int ratio;
+            unsigned int order;
+            // input samples that have gone into the next output
+            unsigned int phase = 0;
+            float inputScale;
+            float outputScale;
+            // integrator and comb delay state of every stage, for I and Q. unsigned, so that overflows wrap around
+            uint64_t* integrators;
+            uint64_t* combs;
+            // integrator output for a block of input
+            uint64_t* scratch;
+            FirFilter<complex<float>, float>* compensation = nullptr;
+            // CIC output waiting for the compensation FIR
+            complex<float>* pending = nullptr;
+            size_t pendingFill = 0;
+            size_t pendingCapacity = 0;
+    };
+
+}
@@ -26,6 +26,7 @@ namespace Csdr {
     class DcBlock : public Csdr::AnyLengthModule<float, float> {
         public:
             void process(float *input, float *output, size_t length) override;
+            bool supportsInPlace() override { return true; }
 
         private:
             float xm1 = 0.0f;
@@ -40,6 +40,7 @@ namespace Csdr {
     class WfmDeemphasis: public AnyLengthModule<float, float> {
         public:
             WfmDeemphasis(unsigned int sampleRate, float tau);
+            bool supportsInPlace() override { return true; }
         protected:
             void process(float* input, float* output, size_t size) override;
         private:
@@ -0,0 +1,52 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <fftw3.h>
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace Csdr {
+
+    // process-wide store for FFTW plans and filter taps, so that modules set up later in a long-running process
+    // (see "csdr daemon") do not have to repeat the work. all methods are thread-safe.
+    class DesignCache {
+        public:
+            // an out-of-place complex FFT plan, owned by the cache. the plan must be run with fftwf_execute_dft()
+            // on arrays allocated with fftwf_alloc_complex(), so that their alignment matches.
+            static fftwf_plan getFftPlan(int size, int sign, unsigned int flags);
+            // FFTW's planner is not thread-safe. plans that do not come from the cache must be created and destroyed
+            // while holding this lock.
+            static std::mutex& plannerMutex();
+            // runs a transform that is only needed once (filter design, for example) with a temporary plan made for
+            // the given arrays, taking care of the planner lock.
+            static void executeOnce(int size, fftwf_complex* input, fftwf_complex* output, int sign);
+            // real to complex. only the first size / 2 + 1 bins of output are written.
+            static void executeOnce(int size, float* input, fftwf_complex* output);
+            // returns a copy of the taps stored under key, calling generate() on the first request.
+            // generate() must return memory from malloc(). the copy must be released with free().
+            template <typename T>
+            static T* getTaps(const std::string& key, size_t length, const std::function<T*()>& generate);
+    };
+
+}
@@ -43,6 +43,8 @@ namespace Csdr {
             void reload() override;
             void restart() override;
             void setArgs(const std::vector<std::string>& args) override;
+            // limits the size of individual reads from and writes to the child
+            void setBlockSizePolicy(const BlockSizePolicy& policy) override;
         private:
             void startChild();
             void stopChild();
@@ -60,6 +62,7 @@ namespace Csdr {
             bool run = true;
             int readOffset = 0;
             int writeOffset = 0;
+            std::atomic<size_t> blockSize{1024};
     };
 
 }
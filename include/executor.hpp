@@ -0,0 +1,69 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "module.hpp"
+#include "threadpolicy.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Csdr {
+
+    // runs any number of modules on a fixed pool of worker threads.
+    // modules are scheduled when their buffers signal progress, idle workers steal work from busy ones.
+    class Executor {
+        public:
+            // 0 threads means one worker per CPU core, or per CPU in the policy's affinity set.
+            // the policy applies to all worker threads.
+            explicit Executor(unsigned int threads = 0, ThreadPolicy policy = ThreadPolicy());
+            ~Executor();
+            void addModule(UntypedModule* module);
+            void removeModule(UntypedModule* module);
+            void stop();
+            bool isRunning() const;
+            size_t getThreadCount() const;
+        private:
+            class Task;
+            class Worker;
+            void loop(size_t index);
+            void schedule(const std::shared_ptr<Task>& task);
+            void enqueue(size_t index, const std::shared_ptr<Task>& task, bool front);
+            void execute(size_t index, const std::shared_ptr<Task>& task);
+            std::shared_ptr<Task> next(size_t index);
+            ThreadPolicy policy;
+            std::atomic<bool> run{true};
+            std::vector<Worker*> workers;
+            std::atomic<size_t> roundRobin{0};
+            std::atomic<size_t> pending{0};
+            std::atomic<size_t> idle{0};
+            std::mutex sleepMutex;
+            std::condition_variable sleepCondition;
+            std::mutex tasksMutex;
+            std::map<UntypedModule*, std::shared_ptr<Task>> tasks;
+    };
+
+}
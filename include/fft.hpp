@@ -34,6 +34,8 @@ namespace Csdr {
             bool canProcess() override;
             void process() override;
             void setEveryNSamples(unsigned int everyNSamples);
+        protected:
+            size_t requiredInput() override { return fftSize + 1; }
         private:
             unsigned int fftSize;
             unsigned int everyNSamples;
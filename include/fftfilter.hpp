@@ -46,6 +46,9 @@ namespace Csdr {
             ~FftFilter() override;
             size_t apply(T* input, T* output, size_t size) override;
             size_t getMinProcessingSize() override { return inputSize; }
+            Filter<T>* clone() override;
+            // the overlap only depends on the previous block
+            size_t getHistory() override { return inputSize; }
         protected:
             explicit FftFilter(size_t fftSize);
             static size_t filterLength(float transition);
@@ -57,6 +60,7 @@ namespace Csdr {
         private:
             fftwf_complex* forwardInput;
             fftwf_complex* forwardOutput;
+            // shared, see DesignCache
             fftwf_plan forwardPlan;
             fftwf_complex* inverseInput;
             fftwf_complex* inverseOutput;
@@ -69,4 +73,40 @@ namespace Csdr {
             FftBandPassFilter(float lowcut, float highcut, float transition, Window* window);
     };
 
+    // lowpass filter and decimation in one, like FirDecimate, but with overlap-save in the frequency domain. the
+    // filtered spectrum is folded onto its first fftSize / decimation bins, which is what decimation does to a
+    // spectrum, and goes through an inverse FFT that is decimation times smaller, so the output comes out at the
+    // reduced rate directly. for long filters, this is much cheaper than evaluating every output sample in the time
+    // domain.
+    class FftDecimator: public Module<complex<float>, complex<float>> {
+        public:
+            FftDecimator(unsigned int decimation, float transitionBandwidth, Window* window, float cutoff = 0.5f);
+            ~FftDecimator() override;
+            bool canProcess() override;
+            void process() override;
+            // the last block, filled up with zeros. only output that does not depend on the zeros is produced.
+            bool finish() override;
+        protected:
+            size_t requiredInput() override { return fftSize; }
+        private:
+            // filters and decimates the next block of input, the output ends up in inverseOutput
+            void processBlock(size_t available);
+            unsigned int decimation;
+            size_t taps_length;
+            size_t fftSize;
+            // fftSize / decimation
+            size_t outputSize;
+            // new input samples per block, a multiple of decimation
+            size_t hop;
+            // spectrum of the taps, scaled for the inverse FFT
+            complex<float>* taps;
+            fftwf_complex* forwardInput;
+            fftwf_complex* forwardOutput;
+            // shared, see DesignCache
+            fftwf_plan forwardPlan;
+            fftwf_complex* inverseInput;
+            fftwf_complex* inverseOutput;
+            fftwf_plan inversePlan;
+    };
+
 }
\ No newline at end of file
@@ -20,6 +20,7 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include "module.hpp"
+#include "segmented.hpp"
 
 #include <cstdlib>
 
@@ -32,6 +33,11 @@ namespace Csdr {
             virtual size_t apply(T* input, T* output, size_t size) = 0;
             virtual size_t getMinProcessingSize() { return 0; }
             virtual size_t getOverhead() { return 0; };
+            // filters that only depend on a bounded amount of past input return an independent copy of themselves,
+            // which allows filtering segments of the input in parallel. nullptr if that is not possible.
+            virtual Filter<T>* clone() { return nullptr; }
+            // input that has to pass through a fresh copy before its output matches the original
+            virtual size_t getHistory() { return 0; }
     };
 
     template <typename T>
@@ -42,6 +48,9 @@ namespace Csdr {
         public:
             SparseView<T> sparse(T* data);
             virtual T processSample(T* data, size_t index) = 0;
+            // count output samples, at input positions offset, offset + stride, offset + 2 * stride and so on.
+            // decimators use this instead of calling processSample() for every output.
+            virtual void processSamples(T* data, size_t offset, size_t stride, T* output, size_t count);
             size_t apply(T* input, T* output, size_t size) override;
     };
 
@@ -56,14 +65,33 @@ namespace Csdr {
     };
 
     template <typename T>
-    class FilterModule: public Module<T, T> {
+    class FilterModule: public SegmentedModule<T, T> {
         public:
             explicit FilterModule(Filter<T>* filter);
             ~FilterModule() override;
             bool canProcess() override;
             void process() override;
             void setFilter(Filter<T>* filter);
+        protected:
+            size_t requiredInput() override;
+            size_t getSegmentAlignment() override;
+            size_t getSegmentOverhead() override;
+            size_t getSegmentOutput(size_t length) override { return length; }
+            SegmentWorker<T, T>* createSegmentWorker() override;
+            void skipTo(T* position) override;
         private:
             Filter<T>* filter;
     };
+
+    template <typename T>
+    class FilterSegmentWorker: public SegmentWorker<T, T> {
+        public:
+            // takes ownership of the filter
+            explicit FilterSegmentWorker(Filter<T>* filter);
+            ~FilterSegmentWorker() override;
+            size_t process(T* input, size_t length, T* output, bool atStart) override;
+        private:
+            Filter<T>* filter;
+            T* scratch;
+    };
 }
\ No newline at end of file
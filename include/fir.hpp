@@ -37,6 +37,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "filter.hpp"
 #include "fftfilter.hpp"
 
+#include <string>
+
 namespace Csdr {
 
     template <typename T, typename U>
@@ -46,23 +48,38 @@ namespace Csdr {
             ~FirFilter();
             T processSample(T* data, size_t index) override;
             T processSample_fmv(T* data, size_t index);
+            void processSamples(T* data, size_t offset, size_t stride, T* output, size_t count) override;
             size_t getOverhead() override;
+            Filter<T>* clone() override;
+            // number of taps for the given transition bandwidth, always odd
+            static size_t filterLength(float transition);
         protected:
             explicit FirFilter(size_t length);
-            static size_t filterLength(float transition);
             void allocateTaps(size_t length);
+            // must be called once the taps are in place, to set up the vectorized kernels
+            void prepareTaps();
             U* taps;
             size_t taps_length;
+            // real taps, repeated for each channel of complex input. only used with complex input and real taps
+            float* kernelTaps = nullptr;
+            // taps[i] == taps[taps_length - 1 - i], which allows folding the input around the center
+            bool symmetric = false;
     };
 
     template <typename T>
     class TapGenerator {
         public:
             explicit TapGenerator(Window* window);
+            virtual ~TapGenerator() = default;
             virtual T* generateTaps(size_t length) = 0;
             complex<float>* generateFftTaps(size_t length, size_t fftSize);
+            // same as the above, but shared through the DesignCache
+            T* getTaps(size_t length);
+            complex<float>* getFftTaps(size_t length, size_t fftSize);
         protected:
             void normalize(T* taps, size_t length);
+            // identifies the design in the DesignCache
+            virtual std::string describe() = 0;
             Window* window;
     };
 
@@ -70,6 +87,8 @@ namespace Csdr {
         public:
             LowPassTapGenerator(float cutoff, Window* window);
             float* generateTaps(size_t length) override;
+        protected:
+            std::string describe() override;
         private:
             float cutoff;
     };
@@ -84,6 +103,8 @@ namespace Csdr {
         public:
             BandPassTapGenerator(float lowcut, float highcut, Window* window);
             complex<float>* generateTaps(size_t length) override;
+        protected:
+            std::string describe() override;
         private:
             float lowcut;
             float highcut;
@@ -23,16 +23,33 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "complex.hpp"
 #include "window.hpp"
 #include "fir.hpp"
+#include "segmented.hpp"
 
 namespace Csdr {
 
-    class FirDecimate: public Module<complex<float>, complex<float>> {
+    class FirDecimate: public SegmentedModule<complex<float>, complex<float>> {
         public:
             FirDecimate(unsigned int decimation, float transitionBandwidth, Window* window, float cutoff);
             FirDecimate(unsigned int decimation, float transitionBandwidth, Window* window);
             ~FirDecimate() override;
             bool canProcess() override;
             void process() override;
+        protected:
+            size_t requiredInput() override;
+            size_t getSegmentAlignment() override { return decimation; }
+            size_t getSegmentOverhead() override;
+            size_t getSegmentOutput(size_t length) override { return length / decimation; }
+            SegmentWorker<complex<float>, complex<float>>* createSegmentWorker() override;
+        private:
+            unsigned int decimation;
+            LowPassFilter<complex<float>>* lowpass;
+    };
+
+    class FirDecimateSegmentWorker: public SegmentWorker<complex<float>, complex<float>> {
+        public:
+            // the filter is only read, so it can be shared
+            FirDecimateSegmentWorker(unsigned int decimation, LowPassFilter<complex<float>>* lowpass);
+            size_t process(complex<float>* input, size_t length, complex<float>* output, bool atStart) override;
         private:
             unsigned int decimation;
             LowPassFilter<complex<float>>* lowpass;
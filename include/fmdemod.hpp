@@ -40,12 +40,10 @@ namespace Csdr {
 
     class FmDemod: public AnyLengthModule<complex<float>, float> {
         public:
+            FmDemod();
             void process(complex<float>* input, float* output, size_t work_size) override;
-        protected:
-            size_t maxLength() override { return buffer_size; }
         private:
             float last_phase = 0;
-            size_t buffer_size = 1024;
     };
 
 }
\ No newline at end of file
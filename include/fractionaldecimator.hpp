@@ -49,6 +49,8 @@ namespace Csdr {
             unsigned int num_poly_points; //number of samples that the Lagrange interpolator will use
             float* poly_precalc_denomiator; //while we don't precalculate coefficients here as in a Farrow structure, because it is a fractional interpolator, but we rather precaculate part of the interpolator expression
             float* coeffs_buf;
+            // the filtered input under the interpolator, for one output sample
+            T* filtered;
             int xifirst;
             int xilast;
             float rate;
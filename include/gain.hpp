@@ -29,6 +29,7 @@ namespace Csdr {
         public:
             explicit Gain(float gain);
             void process(T* input, T* output, size_t size) override;
+            bool supportsInPlace() override { return true; }
         private:
             float gain;
     };
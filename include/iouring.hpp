@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Csdr {
+
+    // minimal io_uring wrapper, talking to the kernel directly so that there is no dependency on liburing.
+    // operations are queued, then submitted in one go, and their completions collected afterwards.
+    // not thread safe: every ring should be used by a single thread at a time.
+    class IoUring {
+        public:
+            // throws std::runtime_error if io_uring is not available
+            explicit IoUring(unsigned entries = 32);
+            ~IoUring();
+            IoUring(const IoUring&) = delete;
+            IoUring& operator=(const IoUring&) = delete;
+            static bool isAvailable();
+            // operations on registered files skip the file table lookup. returns false if the kernel refused.
+            bool registerFiles(const std::vector<int>& fds);
+            // registered memory is pinned once instead of on every operation. operations on memory within this range
+            // use it automatically. returns false if the kernel refused, for example because of RLIMIT_MEMLOCK.
+            bool registerBuffer(void* data, size_t size);
+            // the following return false if the submission queue is full. with link set, the next operation only
+            // starts once this one has completed successfully.
+            bool read(int fd, void* data, size_t length, uint64_t userData, bool link = false);
+            bool write(int fd, const void* data, size_t length, uint64_t userData, bool link = false);
+            bool poll(int fd, short events, uint64_t userData, bool link = false);
+            // cancels a queued or running operation. it completes with -ECANCELED, or normally if it was too late.
+            bool cancel(uint64_t target, uint64_t userData);
+            // submits all queued operations with a single system call and waits until at least minComplete
+            // completions are available. returns false on errors.
+            bool submit(unsigned minComplete = 0);
+            // takes the next completion, if any. result is what the operation returned, or -errno.
+            bool complete(uint64_t& userData, int& result);
+        private:
+            void release();
+            void* prepare(uint8_t opcode, int fd, uint64_t address, uint32_t length, uint64_t userData, bool link);
+            int fd = -1;
+            void* sqRing = nullptr;
+            size_t sqRingSize = 0;
+            void* cqRing = nullptr;
+            size_t cqRingSize = 0;
+            void* sqes = nullptr;
+            size_t sqesSize = 0;
+            unsigned* sqHead = nullptr;
+            unsigned* sqTail = nullptr;
+            unsigned* sqMask = nullptr;
+            unsigned* sqArray = nullptr;
+            unsigned sqEntries = 0;
+            unsigned sqQueued = 0;
+            unsigned sqSubmitted = 0;
+            unsigned* cqHead = nullptr;
+            unsigned* cqTail = nullptr;
+            unsigned* cqMask = nullptr;
+            void* cqes = nullptr;
+            std::vector<int> files;
+            char* buffer = nullptr;
+            size_t bufferSize = 0;
+    };
+
+}
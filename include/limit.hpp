@@ -27,6 +27,7 @@ namespace Csdr {
         public:
             explicit Limit(float maxAmplitude);
             void process(float* input, float* output, size_t size) override;
+            bool supportsInPlace() override { return true; }
         private:
             float maxAmplitude;
     };
@@ -0,0 +1,44 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace Csdr {
+
+    // a file mapped into memory read-only, so that recordings can be processed without copying them around
+    class MappedFile {
+        public:
+            // throws std::runtime_error if the file cannot be opened or mapped
+            explicit MappedFile(const std::string& path);
+            ~MappedFile();
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+            // nullptr for empty files
+            void* getData();
+            // in bytes
+            size_t getSize();
+        private:
+            void* data = nullptr;
+            size_t size = 0;
+    };
+
+}
@@ -22,12 +22,35 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "source.hpp"
 #include "sink.hpp"
 #include "complex.hpp"
+#include "blocksize.hpp"
 
 #include <cstdint>
+#include <memory>
 #include <mutex>
+#include <atomic>
+#include <array>
+#include <functional>
 
 namespace Csdr {
 
+    // snapshot of the runtime statistics of a module
+    class ModuleStatistics {
+        public:
+            // bucket 0 counts process() calls below 1 microsecond, bucket n counts calls below 2^n microseconds.
+            // the last bucket counts everything longer than that.
+            static const size_t HISTOGRAM_BUCKETS = 16;
+            uint64_t samplesIn = 0;
+            uint64_t samplesOut = 0;
+            uint64_t processCalls = 0;
+            uint64_t processNanoseconds = 0;
+            std::array<uint64_t, HISTOGRAM_BUCKETS> processHistogram = {};
+            // time spent blocked in wait()
+            uint64_t waitNanoseconds = 0;
+            // samples waiting in the input, currently and at most
+            size_t inputFill = 0;
+            size_t inputFillHighWater = 0;
+    };
+
     class UntypedModule {
         public:
             virtual ~UntypedModule() = default;
@@ -35,6 +58,30 @@ namespace Csdr {
             virtual void process() = 0;
             virtual void wait(std::unique_lock<std::mutex>& lock) = 0;
             virtual void unblock() = 0;
+            // the listener is invoked whenever the module may be able to make progress
+            virtual void setListener(std::function<void()> /* listener */) {}
+            // calls process() and records how long it took. runners use this instead of calling process() directly.
+            void processTimed();
+            virtual ModuleStatistics getStatistics();
+            // modules that work on blocks of arbitrary size follow this policy. others ignore it.
+            virtual void setBlockSizePolicy(const BlockSizePolicy& /* policy */) {}
+            // true while nothing reads the module's output. runners leave suspended modules alone, and the modules
+            // let go of their input meanwhile (see Reader::suspend()).
+            virtual bool isSuspended() { return false; }
+            // called once the input has ended and everything that could be processed has been. modules that hold
+            // back input until they have a whole block process the rest here. returns true if there was any output,
+            // in which case it is called again once that has travelled on.
+            virtual bool finish() { return false; }
+        protected:
+            void recordWait(uint64_t nanoseconds);
+            void recordInputFill(size_t fill);
+            virtual size_t getInputFill() { return 0; }
+        private:
+            std::atomic<uint64_t> processCalls{0};
+            std::atomic<uint64_t> processNanoseconds{0};
+            std::array<std::atomic<uint64_t>, ModuleStatistics::HISTOGRAM_BUCKETS> processHistogram = {};
+            std::atomic<uint64_t> waitNanoseconds{0};
+            std::atomic<size_t> inputFillHighWater{0};
     };
 
     template <typename T, typename U>
@@ -45,10 +92,30 @@ namespace Csdr {
             void unblock() override;
             void setWriter(Writer<U>* writer) override;
             void setReader(Reader<T>* reader) override;
+            void setListener(std::function<void()> listener) override;
+            ModuleStatistics getStatistics() override;
+            bool isSuspended() override;
+            // continues where another module has left off by moving its reader and writer over to this module.
+            // the read position and any unread data stay with the reader. neither module may be processing meanwhile.
+            void takeOver(Module<T, U>* previous);
+            // modules returning true here produce exactly one output sample per input sample, and their output
+            // may point to the same memory as their input. only meaningful if T and U are the same.
+            virtual bool supportsInPlace() { return false; }
         protected:
             std::mutex processMutex;
+            size_t getInputFill() override;
+            // number of input samples that is necessary to make any progress. readers use this to avoid waking up
+            // for less. must not be more than canProcess() actually needs. called with processMutex held.
+            virtual size_t requiredInput() { return 1; }
+            // whether anything reads the module's output. runners check this before every call to process(), without
+            // processMutex unless the answer has changed, so it has to be cheap (see Ringbuffer::hasReaders()).
+            virtual bool hasReaders();
+            // see isSuspended()
+            std::atomic<bool> suspended{false};
         private:
+            std::function<void()> listener;
             Reader<T>* waitingReader = nullptr;
+            Writer<U>* waitingWriter = nullptr;
     };
 
     template <typename T, typename U>
@@ -56,10 +123,13 @@ namespace Csdr {
         public:
             bool canProcess() override;
             void process() override;
+            void setBlockSizePolicy(const BlockSizePolicy& policy) override;
         protected:
             virtual void process(T* input, U* output, size_t len) = 0;
             virtual size_t maxLength() { return SIZE_MAX; }
             size_t getWorkSize();
+        private:
+            std::unique_ptr<BlockSizePolicy> blockSizePolicy;
     };
 
     template <typename T, typename U>
@@ -70,5 +140,6 @@ namespace Csdr {
         protected:
             virtual void process(T* input, U* output) = 0;
             virtual size_t getLength() = 0;
+            size_t requiredInput() override { return getLength() + 1; }
     };
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "module.hpp"
+
+#include <condition_variable>
+#include <vector>
+
+namespace Csdr {
+
+    template <typename T, typename U>
+    class MultiOutputModule;
+
+    // an additional output of a MultiOutputModule
+    class UntypedOutputPort {
+        public:
+            virtual ~UntypedOutputPort() = default;
+            virtual UntypedWriter* getWriter() = 0;
+            // true if the port's data can be written to this writer
+            virtual bool accepts(UntypedWriter* writer) = 0;
+            // space needed by a single call to process(). the module waits while a port has less than this.
+            virtual size_t requiredSpace() = 0;
+        protected:
+            // the module does this, see MultiOutputModule::setPortWriter()
+            virtual void setWriter(UntypedWriter* writer) = 0;
+        template <typename T, typename U>
+        friend class MultiOutputModule;
+    };
+
+    template <typename V>
+    class OutputPort: public UntypedOutputPort {
+        public:
+            explicit OutputPort(size_t required = 1);
+            Writer<V>* getWriter() override;
+            bool accepts(UntypedWriter* writer) override;
+            size_t requiredSpace() override;
+            bool isConnected();
+            // space available on the port. a port that is not connected takes anything.
+            size_t writeable();
+            // writes a single sample, if the port is connected
+            void write(V value);
+        protected:
+            void setWriter(UntypedWriter* writer) override;
+        private:
+            size_t required;
+            // read without the module's lock by Module::isSuspended()
+            std::atomic<Writer<V>*> writer{nullptr};
+    };
+
+    // a module with additional typed outputs ("ports") next to its main writer. every port can be connected to a
+    // buffer of its own, and every buffer can be read by any number of modules, so intermediate results are only
+    // computed once no matter how many consumers there are. ports that are not connected are not written to.
+    // the module is only suspended once neither its writer nor any of its ports has readers.
+    template <typename T, typename U>
+    class MultiOutputModule: public Module<T, U> {
+        public:
+            MultiOutputModule();
+            size_t getPortCount();
+            UntypedOutputPort* getPort(size_t index);
+            // connects a port, or disconnects it with nullptr. throws std::runtime_error if the writer does not take the
+            // port's data type. a runner may still look at the previous writer's readers until the module has been
+            // processed again (see Module::isSuspended()), so it must not be deleted before that.
+            void setPortWriter(size_t index, UntypedWriter* writer);
+            void setListener(std::function<void()> listener) override;
+            void wait(std::unique_lock<std::mutex>& lock) override;
+            void unblock() override;
+        protected:
+            // registers a port. ports are numbered in the order they are added, usually from the constructor.
+            void addPort(UntypedOutputPort* port);
+            bool hasReaders() override;
+        private:
+            // port buffers cannot be waited on individually, so any change to the module's buffers wakes up wait()
+            void wake();
+            // called with processMutex held
+            bool portsFull();
+            std::vector<UntypedOutputPort*> ports;
+            std::function<void()> listener;
+            std::mutex wakeMutex;
+            std::condition_variable wakeCondition;
+            uint64_t wakeups = 0;
+    };
+
+}
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "module.hpp"
+#include "complex.hpp"
+#include "window.hpp"
+#include "fir.hpp"
+
+#include <vector>
+
+namespace Csdr {
+
+    // one step of a MultistageDecimator
+    class DecimationStage {
+        public:
+            virtual ~DecimationStage() = default;
+            virtual unsigned int getDecimation() = 0;
+            // input needed in addition to count * getDecimation() samples to produce count samples of output
+            virtual size_t getOverhead() = 0;
+            virtual void decimate(complex<float>* input, complex<float>* output, size_t count) = 0;
+    };
+
+    // decimation by 2 with a halfband filter. all taps at an even distance from the center are zero, and the others
+    // are symmetric, so only a quarter of them have to be multiplied.
+    class HalfbandDecimationStage: public DecimationStage {
+        public:
+            HalfbandDecimationStage(float transition, Window* window);
+            ~HalfbandDecimationStage() override;
+            unsigned int getDecimation() override { return 2; }
+            size_t getOverhead() override { return taps_length; }
+            void decimate(complex<float>* input, complex<float>* output, size_t count) override;
+        private:
+            size_t taps_length;
+            float center;
+            // the first half of the taps under the even input samples, which are all nonzero taps except the center one
+            float* taps;
+            size_t folded_length;
+            // the even input samples, gathered for the kernel
+            complex<float>* even = nullptr;
+            size_t even_size = 0;
+    };
+
+    class FirDecimationStage: public DecimationStage {
+        public:
+            FirDecimationStage(unsigned int decimation, float cutoff, float transition, Window* window);
+            ~FirDecimationStage() override;
+            unsigned int getDecimation() override { return decimation; }
+            size_t getOverhead() override { return lowpass->getOverhead(); }
+            void decimate(complex<float>* input, complex<float>* output, size_t count) override;
+        private:
+            unsigned int decimation;
+            LowPassFilter<complex<float>>* lowpass;
+    };
+
+    // decimates like FirDecimate, but in a cascade of halfband stages followed by stages for the odd factors of
+    // the decimation. only the last stage needs the full transition spec; the ones before it run at higher rates
+    // with much wider transitions, which makes large decimations a lot cheaper than a single filter.
+    // the cascade has a longer group delay than the single filter, so the input is preceded by enough zeros that
+    // every output sample is centered on the same input sample as the one FirDecimate produces.
+    class MultistageDecimator: public Module<complex<float>, complex<float>> {
+        public:
+            MultistageDecimator(unsigned int decimation, float transitionBandwidth, Window* window, float cutoff = 0.5f);
+            ~MultistageDecimator() override;
+            bool canProcess() override;
+            void process() override;
+        protected:
+            size_t requiredInput() override;
+        private:
+            // the output of one stage, waiting for the next one
+            struct StageBuffer {
+                complex<float>* data;
+                size_t fill;
+                size_t capacity;
+            };
+            // output that stage index can produce right now
+            size_t stageOutput(size_t index);
+            // runs the first stage on the zeros that are still due, followed by the start of the input
+            size_t decimateLead(complex<float>* output, size_t count);
+            std::vector<DecimationStage*> stages;
+            // buffers[i] sits between stages[i] and stages[i + 1]
+            std::vector<StageBuffer> buffers;
+            // zeros still to be fed to the first stage, and the buffer they are combined with the input in
+            size_t lead = 0;
+            complex<float>* leadBuffer = nullptr;
+            // input still to be dropped, in case the cascade is faster than a single filter
+            size_t skip = 0;
+    };
+
+}
@@ -26,11 +26,8 @@ namespace Csdr {
 
     class PhaseDemod: public AnyLengthModule<complex<float>, float> {
         public:
+            PhaseDemod();
             void process(complex<float>* input, float* output, size_t work_size) override;
-        protected:
-            size_t maxLength() override { return buffer_size; }
-        private:
-            size_t buffer_size = 1024;
     };
 
 }
\ No newline at end of file
@@ -20,13 +20,14 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <functional>
-#include "module.hpp"
+#include "multioutput.hpp"
 #include "complex.hpp"
 
 namespace Csdr {
 
+    // passes the samples through. output port 0 carries one power measurement per block of length samples.
     template <typename T>
-    class Power: public Module<T, T> {
+    class Power: public MultiOutputModule<T, T> {
         public:
             Power(size_t length, unsigned int decimation = 1, std::function<void(float)> callback = 0);
             size_t getLength();
@@ -39,6 +40,7 @@ namespace Csdr {
             size_t length;
             unsigned int decimation;
             std::function<void(float)> callback;
+            OutputPort<float> measurements;
     };
 
     template <typename T>
@@ -22,6 +22,11 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "complex.hpp"
 
 #include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 namespace Csdr {
 
@@ -33,6 +38,16 @@ namespace Csdr {
             virtual void advance(size_t how_much) = 0;
             virtual void wait() = 0;
             virtual void unblock() = 0;
+            // the listener is invoked whenever new data may have become available
+            virtual void setListener(std::function<void()> /* listener */) {}
+            // total number of samples consumed through this reader, for statistics
+            virtual uint64_t getReadCount() { return 0; }
+            // readers supporting this only wake up from wait() once at least this many samples are available
+            virtual void setWakeThreshold(size_t /* threshold */) {}
+            // readers that hold back their buffer let go of it while suspended, and continue with the newest data
+            // once resumed
+            virtual void suspend() {}
+            virtual void resume() {}
     };
 
     template <typename T>
@@ -48,13 +63,19 @@ namespace Csdr {
             size_t available() override;
             T* getReadPointer() override;
             void advance(size_t how_much) override;
+            // no more data will ever arrive, so this only returns once there is data or the reader is unblocked
             void wait() override;
-            void unblock() override {}
+            void unblock() override;
             void rewind();
+            uint64_t getReadCount() override;
         private:
             T* data;
             size_t size;
-            size_t read_pos = 0;
+            std::atomic<size_t> read_pos{0};
+            std::atomic<uint64_t> read_count{0};
+            bool unblocked = false;
+            std::mutex waitMutex;
+            std::condition_variable waitCondition;
     };
 
 }
\ No newline at end of file
@@ -23,11 +23,13 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "writer.hpp"
 
 #include <cstdlib>
+#include <cstdint>
 #include <stdexcept>
 #include <unistd.h>
 #include <mutex>
-#include <condition_variable>
+#include <atomic>
 #include <set>
+#include <vector>
 
 namespace Csdr {
 
@@ -36,13 +38,27 @@ namespace Csdr {
             explicit BufferError(const std::string& err): std::runtime_error(err) {}
     };
 
+    // memory backends for the mirrored ringbuffer mapping
+    enum class RingbufferMemory {
+        // anonymous shared mapping, mirrored using mremap(). may need several attempts.
+        ANONYMOUS,
+        // memfd mapped twice into a reserved address range
+        MEMFD,
+        // memfd backed by huge pages (MFD_HUGETLB), or transparent huge pages if no huge pages are reserved
+        HUGEPAGES,
+    };
+
     template <typename T>
     class RingbufferReader;
 
+    template <typename T>
+    class InPlaceWriter;
+
     template <typename T>
     class Ringbuffer: public Writer<T> {
         public:
-            explicit Ringbuffer<T>(size_t size);
+            // the requested memory backend falls back to the next simpler one if it is not available
+            explicit Ringbuffer<T>(size_t size, RingbufferMemory memory = RingbufferMemory::MEMFD);
             ~Ringbuffer() override;
             size_t writeable() override;
             T* getWritePointer() override;
@@ -51,34 +67,157 @@ namespace Csdr {
             void advance(size_t& what, size_t how_much);
             size_t available(size_t read_pos);
             size_t getWritePos();
-            void wait();
-            void unblock();
+            // total number of samples written since the buffer was created
+            uint64_t getWriteCount() override;
+            size_t getSize();
+            // the memory backend that is actually in use
+            RingbufferMemory getMemory();
+            // the memfd backing the buffer, or -1 if the buffer is not file backed
+            int getFd();
+            // touches all pages so that the first pass of data does not cause page faults. call before writing any data.
+            void prefault();
+            // blocks the producer until a reader has made progress (only meaningful with backpressure enabled)
+            void wait() override;
+            // blocks until the buffer has been advanced or unblocked since the generation given in "seen"
+            void wait(uint32_t& seen);
+            // blocks until the reader's wake threshold has been reached, or the buffer is unblocked
+            void wait(RingbufferReader<T>* reader);
+            void unblock() override;
+            // when enabled, writeable() is limited by the slowest reader instead of overwriting unread data
+            void setBackpressure(bool backpressure);
+            bool hasBackpressure() override;
+            void setListener(std::function<void()> listener) override;
+            void setListener(RingbufferReader<T>* reader, std::function<void()> listener);
             void addReader(RingbufferReader<T>* reader);
             void removeReader(RingbufferReader<T>* reader);
+            // suspended readers stay known to the buffer, but they neither hold it back nor get woken up
+            void suspendReader(RingbufferReader<T>* reader);
+            // puts a suspended reader back at the newest data, along with any readers following it in place
+            void resumeReader(RingbufferReader<T>* reader);
+            bool hasReaders() override;
+            // true if any active reader follows the given one in place
+            bool hasFollowers(RingbufferReader<T>* reader);
+            // wakes up the readers after new data has been written
+            void notifyReaders();
+            // wakes up the writer after room has been made, or the readers have changed
+            void notifyWriter();
         private:
-            T* allocate_mirrored(size_t size);
+            T* allocate_mirrored(size_t size, RingbufferMemory memory);
+            T* allocate_anonymous(size_t size);
+            T* allocate_memfd(size_t size, bool hugetlb);
+            // an immutable copy of the active readers and their listeners, so that notifications and writeable() can run
+            // without the lock.
+            // republished by publish() under readersMutex whenever any of them changes.
+            struct ReaderEntry {
+                RingbufferReader<T>* reader;
+                std::function<void()> listener;
+            };
+            struct Snapshot {
+                std::vector<ReaderEntry> readers;
+                std::function<void()> writerListener;
+            };
+            // must be called with readersMutex held. returns once nobody is using the previous snapshot anymore.
+            void publish();
+            // wakes up anybody blocked in wait()
+            void wakeWaiters();
+            Snapshot* acquireSnapshot(uint32_t& slot);
+            void releaseSnapshot(uint32_t slot);
             T* data = nullptr;
             size_t size;
-            size_t write_pos = 0;
-            std::mutex mutex;
-            std::condition_variable condition;
+            RingbufferMemory memory;
+            int fd = -1;
+            // producer and consumer state is kept on separate cache lines to avoid false sharing.
+            // explicit padding instead of alignas(), since operator new does not honour over-alignment before C++17.
+            char producerPadding[64];
+            std::atomic<uint64_t> write_count{0};
+            char consumerPadding[64 - sizeof(std::atomic<uint64_t>)];
+            std::atomic<uint32_t> generation{0};
+            std::atomic<uint32_t> waiters{0};
+            // readers sleeping on their own wake threshold
+            std::atomic<uint32_t> sleepers{0};
+            uint32_t writer_generation = 0;
+            std::atomic<bool> backpressure{false};
+            std::mutex readersMutex;
             std::set<RingbufferReader<T>*> readers = {};
+            std::set<RingbufferReader<T>*> suspendedReaders = {};
+            // number of reader listeners
+            std::atomic<int> listeners{0};
+            std::atomic<bool> writerListening{false};
+            // number of active readers, see hasReaders()
+            std::atomic<size_t> activeReaders{0};
+            std::function<void()> writerListener;
+            std::atomic<Snapshot*> snapshot;
+            // snapshot users are counted in one of two slots, selected by the epoch. publish() flips the epoch and
+            // waits for the old slot to drain, while new users already count in the other one.
+            std::atomic<uint32_t> epoch{0};
+            std::atomic<uint32_t> snapshotUsers[2];
     };
 
     template <typename T>
     class RingbufferReader: public Reader<T> {
         public:
             explicit RingbufferReader<T>(Ringbuffer<T>* buffer);
+            // a reader that only sees the samples that "upstream" has already consumed. used for in-place processing.
+            RingbufferReader<T>(Ringbuffer<T>* buffer, RingbufferReader<T>* upstream);
             ~RingbufferReader();
             size_t available() override;
             T* getReadPointer() override;
             void advance(size_t how_much) override;
             void wait() override;
             void unblock() override;
+            void setListener(std::function<void()> listener) override;
+            void setWakeThreshold(size_t threshold) override;
+            void suspend() override;
+            void resume() override;
             void onBufferDelete();
+            // total number of samples consumed (or skipped) since the reader was attached
+            uint64_t getReadCount() override;
+            // number of times this reader has been lapped by the writer
+            size_t getOverruns();
+            // number of samples that were lost due to overruns
+            uint64_t getDroppedSamples();
         private:
             Ringbuffer<T>* buffer;
-            size_t read_pos;
+            RingbufferReader<T>* upstream = nullptr;
+            // keeps the consumer position off the cache lines of whatever the reader is allocated next to
+            char readPadding[64];
+            std::atomic<uint64_t> read_count;
+            char statePadding[64 - sizeof(std::atomic<uint64_t>)];
+            // samples available without any side effects, safe to call from the producer
+            uint64_t pending();
+            bool isReady();
+            uint32_t generation = 0;
+            std::atomic<size_t> threshold{1};
+            // futex word for threshold waits
+            std::atomic<uint32_t> wakeup{0};
+            std::atomic<bool> sleeping{false};
+            std::atomic<size_t> overruns{0};
+            std::atomic<uint64_t> dropped{0};
+            // managed by the buffer under its lock
+            std::function<void()> listener;
+        friend class Ringbuffer<T>;
+        friend class InPlaceWriter<T>;
+    };
+
+    // hands a module the window it is currently reading from as its output, so that it can transform the samples
+    // in place. a RingbufferReader following the same reader picks up the results without another copy.
+    template <typename T>
+    class InPlaceWriter: public Writer<T> {
+        public:
+            explicit InPlaceWriter(RingbufferReader<T>* reader);
+            size_t writeable() override;
+            T* getWritePointer() override;
+            void advance(size_t how_much) override;
+            uint64_t getWriteCount() override;
+            // only the readers following in place read what we write
+            bool hasReaders() override;
+            // waits for any change to the buffer, such as a follower resuming
+            void wait() override;
+            void unblock() override;
+        private:
+            RingbufferReader<T>* reader;
+            std::atomic<uint64_t> write_count{0};
+            uint32_t generation = 0;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "module.hpp"
+
+namespace Csdr {
+
+    // works on one segment of input at a time, independently of the module that created it and of other workers
+    template <typename T, typename U>
+    class SegmentWorker {
+        public:
+            virtual ~SegmentWorker() = default;
+            // processes length samples of input, which is a multiple of the segment alignment. the segment history
+            // before input and the segment overhead after it are readable, unless atStart is set: then the segment
+            // begins where the module would have started, and there is no history.
+            // returns the number of output samples written.
+            virtual size_t process(T* input, size_t length, U* output, bool atStart) = 0;
+    };
+
+    // container class for template-agnostic access
+    class UntypedSegmentedModule {
+        public:
+            virtual ~UntypedSegmentedModule() = default;
+            // processes as much of the available input as possible, and leaves the rest to process().
+            // returns false if segmented processing is not possible.
+            virtual bool processSegmented(unsigned int threads) = 0;
+    };
+
+    // modules whose output for a segment of input only depends on that segment and a bounded amount of input around
+    // it. when all input is available up front, as with a recording, the segments can be processed on several
+    // threads at once, and the output is identical to calling process() repeatedly.
+    template <typename T, typename U>
+    class SegmentedModule: public UntypedSegmentedModule, public Module<T, U> {
+        public:
+            bool processSegmented(unsigned int threads) override;
+        protected:
+            // segments start at multiples of this many input samples
+            virtual size_t getSegmentAlignment() = 0;
+            // input that is necessary after the end of a segment
+            virtual size_t getSegmentOverhead() = 0;
+            // output produced from length samples of input
+            virtual size_t getSegmentOutput(size_t length) = 0;
+            // returns nullptr if the current configuration cannot be split into segments
+            virtual SegmentWorker<T, U>* createSegmentWorker() = 0;
+            // brings the module into the state it would be in after processing all input before position.
+            // called with processMutex held.
+            virtual void skipTo(T* /* position */) {}
+    };
+
+}
@@ -0,0 +1,135 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "reader.hpp"
+#include "writer.hpp"
+
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <sys/types.h>
+
+namespace Csdr {
+
+    // lives in the first page of the shared memory, followed by the samples
+    struct SharedRingbufferControl {
+        uint32_t magic;
+        uint32_t elementSize;
+        uint64_t size;
+        pid_t writerPid;
+        std::atomic<pid_t> readerPid;
+        std::atomic<uint32_t> closed;
+        std::atomic<uint32_t> detached;
+        // producer and consumer state is kept on separate cache lines to avoid false sharing
+        alignas(64) std::atomic<uint64_t> write_count;
+        // futex word, bumped on every write
+        std::atomic<uint32_t> written;
+        // number of threads sleeping on "written"
+        std::atomic<uint32_t> readerSleeping;
+        alignas(64) std::atomic<uint64_t> read_count;
+        // futex word, bumped on every read
+        std::atomic<uint32_t> consumed;
+        // number of threads sleeping on "consumed"
+        std::atomic<uint32_t> writerSleeping;
+    };
+
+    // a mirrored ringbuffer in a memfd that can be passed to another process, where a SharedRingbufferReader
+    // reads the samples directly from the same memory. positions are kept in the shared memory, and both sides
+    // sleep on process-shared futexes.
+    // there is exactly one reader, and the writer waits for it when the buffer is full, just like with a pipe.
+    // if the reader goes away, the module writing to it is suspended (see Module::isSuspended()).
+    // the other process cannot invoke our listeners, so a helper thread watches for changes once a listener is set.
+    template <typename T>
+    class SharedRingbuffer: public Writer<T> {
+        public:
+            // throws BufferError if the shared memory cannot be set up
+            explicit SharedRingbuffer(size_t size);
+            // tells the reader that no more data will follow
+            ~SharedRingbuffer() override;
+            SharedRingbuffer(const SharedRingbuffer&) = delete;
+            SharedRingbuffer& operator=(const SharedRingbuffer&) = delete;
+            size_t writeable() override;
+            T* getWritePointer() override;
+            void advance(size_t how_much) override;
+            bool hasBackpressure() override { return true; }
+            // readers cannot come back once they have gone away
+            bool hasReaders() override;
+            // blocks until the reader has made progress, or for a while if there is no reader anymore
+            void wait() override;
+            void unblock() override;
+            void setListener(std::function<void()> listener) override;
+            uint64_t getWriteCount() override;
+            // the descriptor to pass to the reading process
+            int getFd();
+        private:
+            bool readerGone();
+            SharedRingbufferControl* control;
+            T* data;
+            size_t size;
+            int fd;
+            uint32_t writerSeen = 0;
+            std::atomic<bool> unblocked{false};
+            std::mutex listenerMutex;
+            std::function<void()> listener;
+            std::atomic<bool> watching{true};
+            std::thread watcher;
+    };
+
+    template <typename T>
+    class SharedRingbufferReader: public Reader<T> {
+        public:
+            // attaches to a SharedRingbuffer in another process. takes ownership of fd.
+            // throws BufferError if fd does not refer to a buffer for this type, or if it already has a reader.
+            explicit SharedRingbufferReader(int fd);
+            ~SharedRingbufferReader() override;
+            SharedRingbufferReader(const SharedRingbufferReader&) = delete;
+            SharedRingbufferReader& operator=(const SharedRingbufferReader&) = delete;
+            size_t available() override;
+            T* getReadPointer() override;
+            void advance(size_t how_much) override;
+            // returns once there is enough data (see setWakeThreshold()), or the writer has closed the buffer
+            void wait() override;
+            void unblock() override;
+            void setListener(std::function<void()> listener) override;
+            void setWakeThreshold(size_t threshold) override;
+            uint64_t getReadCount() override;
+            // true once the writer has finished or died. samples that are still available can be read.
+            bool isClosed();
+            // blocks until isClosed() or the reader is unblocked
+            void waitForClose();
+        private:
+            SharedRingbufferControl* control;
+            T* data;
+            size_t size;
+            uint32_t seen = 0;
+            std::atomic<size_t> threshold{1};
+            std::atomic<bool> unblocked{false};
+            std::atomic<bool> writerGone{false};
+            std::mutex listenerMutex;
+            std::function<void()> listener;
+            std::atomic<bool> watching{true};
+            std::thread watcher;
+    };
+
+}
@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "module.hpp"
 #include "complex.hpp"
 
+#include <algorithm>
+
 namespace Csdr {
 
     class Shift {
@@ -48,11 +50,14 @@ namespace Csdr {
         public:
             explicit ShiftAddfast(float rate);
             void setRate(float rate) override;
+            void setBlockSizePolicy(const BlockSizePolicy& policy) override;
         protected:
             void process(complex<float>* input, complex<float>* output) override;
             void process_fmv(complex<float>* input, complex<float>* output, size_t size);
-            size_t getLength() override { return 1024; }
+            // the unrolled loop works on multiples of 4 samples
+            size_t getLength() override { return std::max(blockSizePolicy.getBlockSize() & ~(size_t) 3, (size_t) 4); }
         private:
+            BlockSizePolicy blockSizePolicy;
             float starting_phase = 0.0;
             float dsin[4];
             float dcos[4];
@@ -63,6 +68,7 @@ namespace Csdr {
         public:
             explicit ShiftMath(float rate);
             void setRate(float rate) override;
+            bool supportsInPlace() override { return true; }
         protected:
             void process(complex<float>* input, complex<float>* output, size_t size) override;
             void process_fmv(complex<float>* input, complex<float>* output, size_t size);
@@ -31,13 +31,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include <functional>
-#include "module.hpp"
+#include "multioutput.hpp"
 #include <fftw3.h>
 
 namespace Csdr {
 
+    // passes the samples through. output port 0 carries one SNR measurement per block of length samples.
     template <typename T>
-    class Snr: public Module<T, T> {
+    class Snr: public MultiOutputModule<T, T> {
         public:
             Snr(size_t length, size_t fftSize = 256, std::function<void(float)> callback = 0);
             ~Snr() override;
@@ -54,6 +55,7 @@ namespace Csdr {
             size_t length;
             size_t fftSize;
             std::function<void(float)> callback;
+            OutputPort<float> measurements;
 
             fftwf_complex* fftInput;
             fftwf_complex* fftOutput;
@@ -24,6 +24,7 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include <arpa/inet.h>
 #include <stdexcept>
 #include <thread>
+#include <atomic>
 
 namespace Csdr {
 
@@ -56,10 +57,13 @@ namespace Csdr {
             ~TcpSource();
             void setWriter(Writer<T>* writer) override;
             void stop();
+            // maximum number of samples received in one go
+            void setBlockSize(size_t blockSize);
         private:
             void loop();
             int sock;
             bool run = true;
+            std::atomic<size_t> blockSize{1024};
             std::thread* thread = nullptr;
     };
 
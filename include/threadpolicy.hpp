@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Csdr {
+
+    // describes where and how a processing thread should run
+    class ThreadPolicy {
+        public:
+            // CPUs the thread may run on. empty means no restriction.
+            void setCpus(std::vector<unsigned int> cpus);
+            const std::vector<unsigned int>& getCpus() const;
+            // one of SCHED_OTHER, SCHED_FIFO or SCHED_RR. priority is only used by the realtime policies.
+            void setScheduler(int scheduler, int priority = 0);
+            int getScheduler() const;
+            int getPriority() const;
+            bool isDefault() const;
+            // applies the policy to the calling thread.
+            // failures are reported on stderr, and the thread keeps running with whatever could be applied.
+            bool apply() const;
+            bool operator==(const ThreadPolicy& other) const;
+            bool operator!=(const ThreadPolicy& other) const;
+
+            // parses CPU lists like "0,2-3". throws std::invalid_argument on malformed input.
+            static std::vector<unsigned int> parseCpus(const std::string& cpus);
+            // parses "other", "fifo" or "rr". throws std::invalid_argument on unknown names.
+            static int parseScheduler(const std::string& scheduler);
+            // locks all current and future memory of the process to avoid page faults during processing
+            static bool lockMemory();
+        private:
+            std::vector<unsigned int> cpus;
+            int scheduler = 0;
+            int priority = 0;
+    };
+
+}
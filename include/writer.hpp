@@ -22,7 +22,10 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "complex.hpp"
 
 #include <cstdlib>
+#include <cstdint>
+#include <atomic>
 #include <mutex>
+#include <functional>
 
 namespace Csdr {
 
@@ -32,6 +35,20 @@ namespace Csdr {
             virtual ~UntypedWriter() = default;
             virtual size_t writeable() = 0;
             virtual void advance(size_t how_much) = 0;
+            // writers that can run out of space block in wait() until space becomes available
+            virtual bool hasBackpressure() { return false; }
+            virtual void wait() {}
+            virtual void unblock() {}
+            // the listener is invoked whenever space may have become available
+            virtual void setListener(std::function<void()> /* listener */) {}
+            // total number of samples written through this writer, for statistics
+            virtual uint64_t getWriteCount() { return 0; }
+            // writers that hold back output write it out now
+            virtual void flush() {}
+            // false while nobody reads the output, so there is no point in producing any
+            virtual bool hasReaders() { return true; }
+            // true once writing has failed for good, usually because the consumer has gone away
+            virtual bool isClosed() { return false; }
     };
 
     template <typename T>
@@ -45,13 +62,20 @@ namespace Csdr {
         public:
             StdoutWriter();
             StdoutWriter(size_t buffer_size);
+            // writes to fd instead of stdout
+            StdoutWriter(int fd, size_t buffer_size);
             ~StdoutWriter();
             size_t writeable() override;
             T* getWritePointer() override;
             void advance(size_t how_much) override;
+            uint64_t getWriteCount() override;
+            bool isClosed() override;
         private:
+            int fd;
             size_t buffer_size;
             T* buffer;
+            std::atomic<uint64_t> write_count{0};
+            std::atomic<bool> closed{false};
     };
 
     template <typename T>
@@ -62,10 +86,12 @@ namespace Csdr {
             ~VoidWriter();
             size_t writeable() override;
             T* getWritePointer() override;
-            void advance(__attribute__((unused)) size_t how_much) override {}
+            void advance(size_t how_much) override;
+            uint64_t getWriteCount() override;
         private:
             size_t buffer_size;
             T* data;
+            std::atomic<uint64_t> write_count{0};
     };
 
 }
\ No newline at end of file
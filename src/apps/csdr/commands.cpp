@@ -19,6 +19,12 @@ along with csdr.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "commands.hpp"
 #include "async.hpp"
+#include "executor.hpp"
+#include "bufferedwriter.hpp"
+#include "mappedfile.hpp"
+#include "iouring.hpp"
+#include "segmented.hpp"
+#include "sharedringbuffer.hpp"
 
 #include "agc.hpp"
 #include "fmdemod.hpp"
@@ -31,6 +37,8 @@ along with csdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "fftexchangesides.hpp"
 #include "realpart.hpp"
 #include "firdecimate.hpp"
+#include "multistagedecimator.hpp"
+#include "cicdecimator.hpp"
 #include "benchmark.hpp"
 #include "fractionaldecimator.hpp"
 #include "adpcm.hpp"
@@ -60,102 +68,669 @@ along with csdr.  If not, see <https://www.gnu.org/licenses/>.
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <csignal>
+#include <pthread.h>
 #include <cstdio>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
 
 using namespace Csdr;
 
+template <typename T>
+inline std::string typeName() { return "unknown"; }
+template <> std::string typeName<unsigned char>() { return "char"; }
+template <> std::string typeName<short>() { return "s16"; }
+template <> std::string typeName<float>() { return "float"; }
+template <> std::string typeName<complex<unsigned char>>() { return "complex char"; }
+template <> std::string typeName<complex<short>>() { return "complex s16"; }
+template <> std::string typeName<complex<float>>() { return "complex float"; }
+
+namespace Csdr {
+
+    // in-place processing is only possible if input and output types are the same
+    template <typename T, typename U>
+    struct InPlace {
+        static Writer<U>* getWriter(RingbufferReader<T>* /* reader */) { return nullptr; }
+    };
+
+    template <typename T>
+    struct InPlace<T, T> {
+        static Writer<T>* getWriter(RingbufferReader<T>* reader) { return new InPlaceWriter<T>(reader); }
+    };
+
+    // in synchronous mode, a full output has to hold up processing just like a blocking write() would (see Module::wait()).
+    // returns false if the output is not what holds the module back.
+    template <typename T, typename U>
+    static bool waitForOutput(Module<T, U>* module) {
+        auto output = module->getWriter();
+        if (!output->hasBackpressure() || output->writeable() >= module->getReader()->available()) return false;
+        output->wait();
+        return true;
+    }
+
+    template <typename T, typename U>
+    class ChainStage: public UntypedChainStage {
+        public:
+            // without a bufferSize, the stage has no input until it takes over another one (see takeOver())
+            ChainStage(Command* command, Module<T, U>* module, size_t bufferSize, RingbufferMemory memory):
+                command(command),
+                module(module),
+                input(bufferSize > 0 ? new Ringbuffer<T>(bufferSize, memory) : nullptr),
+                reader(input != nullptr ? new RingbufferReader<T>(input) : nullptr)
+            {
+                if (input == nullptr) return;
+                // everything stays inside this process, so nothing should ever be dropped
+                input->setBackpressure(true);
+                module->setReader(reader);
+            }
+            ~ChainStage() override {
+                delete reader;
+                delete fileReader;
+                delete sharedReader;
+                if (ownsInput) delete input;
+                delete writer;
+            }
+            UntypedModule* getModule() override { return module; }
+            Command* getCommand() override { return command; }
+            UntypedWriter* getInput() override { return input; }
+            UntypedReader* getReader() override { return reader; }
+            std::string getInputType() override { return typeName<T>(); }
+            std::string getOutputType() override { return typeName<U>(); }
+            bool connect(UntypedChainStage* next) override {
+                // files are mapped read-only, so only stages reading from a buffer can work in place
+                if (module->supportsInPlace() && reader != nullptr) {
+                    Writer<U>* inPlaceWriter = InPlace<T, U>::getWriter(reader);
+                    if (inPlaceWriter != nullptr && next->followInPlace(input, reader)) {
+                        writer = inPlaceWriter;
+                        inPlace = true;
+                        module->setWriter(writer);
+                        return true;
+                    }
+                    delete inPlaceWriter;
+                }
+                auto nextInput = dynamic_cast<Writer<U>*>(next->getInput());
+                if (nextInput == nullptr) return false;
+                module->setWriter(nextInput);
+                return true;
+            }
+            bool followInPlace(UntypedWriter* buffer, UntypedReader* upstream) override {
+                auto ring = dynamic_cast<Ringbuffer<T>*>(buffer);
+                auto upstreamReader = dynamic_cast<RingbufferReader<T>*>(upstream);
+                if (ring == nullptr || upstreamReader == nullptr) return false;
+                auto follower = new RingbufferReader<T>(ring, upstreamReader);
+                module->setReader(follower);
+                delete reader;
+                reader = follower;
+                if (ownsInput) delete input;
+                input = ring;
+                ownsInput = false;
+                return true;
+            }
+            bool connectStdout() override {
+                writer = command->stdoutWriter<U>();
+                if (writer == nullptr) return false;
+                module->setWriter(writer);
+                return true;
+            }
+            bool waitForOutput() override {
+                return Csdr::waitForOutput(module);
+            }
+            void prefault() override {
+                if (ownsInput) input->prefault();
+            }
+            void readInput(const std::vector<Command*>& controls, const std::function<void()>& processAll) override {
+                if (sharedReader != nullptr) {
+                    command->readShared(sharedReader, processAll);
+                } else {
+                    command->readLoop(input, controls, processAll);
+                }
+            }
+            bool processSegmented(unsigned int threads) override {
+                auto segmented = dynamic_cast<UntypedSegmentedModule*>(module);
+                return segmented != nullptr && segmented->processSegmented(threads);
+            }
+            void readFile(MappedFile* file) override {
+                fileReader = new MemoryReader<T>((T*) file->getData(), file->getSize() / sizeof(T));
+                replaceInput(fileReader);
+            }
+            bool readShared() override {
+                sharedReader = command->sharedInput<T>();
+                if (sharedReader == nullptr) return false;
+                replaceInput(sharedReader);
+                return true;
+            }
+            bool takeOver(UntypedChainStage* previous) override {
+                auto other = dynamic_cast<ChainStage<T, U>*>(previous);
+                if (other == nullptr) return false;
+                // the next stage reads from our input buffer, so we have to be able to write to it in place
+                if (other->inPlace && !module->supportsInPlace()) return false;
+                module->takeOver(other->module);
+                delete reader;
+                if (ownsInput) delete input;
+                input = other->input;
+                ownsInput = other->ownsInput;
+                reader = other->reader;
+                fileReader = other->fileReader;
+                sharedReader = other->sharedReader;
+                writer = other->writer;
+                inPlace = other->inPlace;
+                other->input = nullptr;
+                other->ownsInput = false;
+                other->reader = nullptr;
+                other->fileReader = nullptr;
+                other->sharedReader = nullptr;
+                other->writer = nullptr;
+                return true;
+            }
+            bool isOutputClosed() override {
+                return writer != nullptr && writer->isClosed();
+            }
+        private:
+            // the input buffer is not needed when reading from elsewhere
+            void replaceInput(Reader<T>* replacement) {
+                module->setReader(replacement);
+                delete reader;
+                reader = nullptr;
+                if (ownsInput) delete input;
+                input = nullptr;
+                ownsInput = false;
+            }
+            Command* command;
+            Module<T, U>* module;
+            Ringbuffer<T>* input;
+            bool ownsInput = true;
+            RingbufferReader<T>* reader;
+            // replaces the reader when the chain is fed from a file
+            MemoryReader<T>* fileReader = nullptr;
+            // replaces the reader when the chain is fed from another process
+            SharedRingbufferReader<T>* sharedReader = nullptr;
+            // the writer owned by this stage, if any (stdout or in-place)
+            Writer<U>* writer = nullptr;
+            bool inPlace = false;
+    };
+
+}
+
 template <typename T, typename U>
 void Command::runModule(Module<T, U>* module) {
-    auto buffer = new Ringbuffer<T>(bufferSize());
-    module->setReader(new RingbufferReader<T>(buffer));
-    auto writer = new StdoutWriter<U>();
+    applyBlockSize(module);
+
+    if (chain != nullptr) {
+        chain->addStage(new ChainStage<T, U>(this, module, chain->isReplacing() ? 0 : bufferSize(), bufferMemory()));
+        return;
+    }
+
+    Ringbuffer<T>* buffer = nullptr;
+    MappedFile* file = nullptr;
+    SharedRingbufferReader<T>* shared = nullptr;
+    if (*getGlobals()->get_option("--input")) {
+        file = mapInput();
+        if (file == nullptr) return;
+        module->setReader(new MemoryReader<T>((T*) file->getData(), file->getSize() / sizeof(T)));
+    } else if (*getGlobals()->get_option("--shm-input")) {
+        shared = sharedInput<T>();
+        if (shared == nullptr) return;
+        module->setReader(shared);
+    } else {
+        buffer = new Ringbuffer<T>(bufferSize(), bufferMemory());
+        prepareBuffer(buffer);
+        module->setReader(new RingbufferReader<T>(buffer));
+    }
+    auto writer = stdoutWriter<U>();
+    if (writer == nullptr) {
+        delete buffer;
+        delete file;
+        delete shared;
+        return;
+    }
     module->setWriter(writer);
 
     AsyncRunner* runner = nullptr;
-    if (*get_parent()->get_option("--async")) {
-        runner = new AsyncRunner(module);
+    if (*getGlobals()->get_option("--async")) {
+        runner = new AsyncRunner(module, threadPolicy());
+    }
+
+    std::function<void()> processAll = nullptr;
+    // synchronous processing if we are not in async mode
+    if (runner == nullptr) {
+        threadPolicy().apply();
+        processAll = [module] {
+            do {
+                while (!module->isSuspended() && module->canProcess()) module->processTimed();
+            } while (waitForOutput(module));
+        };
     }
 
+    auto stats = startStatistics({{get_name(), module}});
+
+    if (file != nullptr) {
+        if (*getGlobals()->get_option("--parallel")) {
+            auto segmented = dynamic_cast<UntypedSegmentedModule*>(module);
+            if (segmented == nullptr || !segmented->processSegmented(getGlobals()->get_option("--parallel")->as<unsigned int>())) {
+                getErrors() << "WARNING: " << get_name() << " cannot process in parallel\n";
+            }
+        }
+        // all input is there already, so there is nothing to wait for
+        if (processAll) processAll();
+    } else if (shared != nullptr) {
+        readShared(shared, processAll);
+    } else {
+        readLoop(buffer, {this}, processAll);
+    }
+
+    if (processAll) {
+        finish({module}, processAll);
+    } else {
+        finish({module}, [module] { drain({module}); });
+    }
+    delete stats;
+    delete runner;
+    // along with anything its callbacks hold on to
+    delete module;
+    // writes out anything that is still held back
+    delete writer;
+    delete buffer;
+    delete file;
+    delete shared;
+}
+
+static bool isPipe(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+static void raisePipeSize(int fd) {
+    // a bigger pipe means fewer, larger reads. the unprivileged limit is in /proc/sys/fs/pipe-max-size.
+    int size = 1048576;
+    FILE* f = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if (f != nullptr) {
+        if (fscanf(f, "%d", &size) != 1) size = 1048576;
+        fclose(f);
+    }
+    if (fcntl(fd, F_GETPIPE_SZ) < size) fcntl(fd, F_SETPIPE_SZ, size);
+}
+
+template <typename T>
+static ssize_t spliceInput(int in, Ringbuffer<T>* buffer, size_t offset, size_t length) {
+    // the mirror mapping only exists in memory, so a splice must not run past the end of the file
+    loff_t position = (loff_t) (buffer->getWritePos() * sizeof(T) + offset);
+    length = std::min(length, buffer->getSize() * sizeof(T) - (size_t) position);
+    return splice(in, nullptr, buffer->getFd(), &position, length, SPLICE_F_MOVE);
+}
+
+static bool socketAddress(const std::string& path, struct sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "socket path too long: " << path << "\n";
+        return false;
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return true;
+}
+
+// returns -1 and reports on stderr if the socket cannot be set up
+static int listenSocket(const std::string& path) {
+    struct sockaddr_un address;
+    if (!socketAddress(path, address)) return -1;
+    // a socket left behind by an earlier run would make bind() fail. anything else is not ours to remove.
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        std::cerr << "unable to listen on " << path << ": " << strerror(errno) << "\n";
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// returns -1 and reports on stderr if the connection fails. with a timeout, waits for the socket to appear.
+static int connectSocket(const std::string& path, std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+    struct sockaddr_un address;
+    if (!socketAddress(path, address)) return -1;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connection < 0) break;
+        if (connect(connection, (struct sockaddr*) &address, sizeof(address)) == 0) return connection;
+        int error = errno;
+        close(connection);
+        errno = error;
+        if ((error != ENOENT && error != ECONNREFUSED) || std::chrono::steady_clock::now() >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cerr << "unable to connect to " << path << ": " << strerror(errno) << "\n";
+    return -1;
+}
+
+// sends a message along with file descriptors (SCM_RIGHTS). returns false and leaves errno set if that fails.
+static bool sendDescriptors(int connection, const std::string& message, const std::vector<int>& fds) {
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+    struct iovec iov = { .iov_base = (void*) message.data(), .iov_len = message.size() };
+    struct msghdr header = {};
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_control = control.data();
+    header.msg_controllen = control.size();
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    // the descriptors travel with the first byte, the rest of the message may follow separately
+    ssize_t sent = sendmsg(connection, &header, MSG_NOSIGNAL);
+    while (sent >= 0 && (size_t) sent < message.size()) {
+        ssize_t more = send(connection, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        sent = more < 0 ? more : sent + more;
+    }
+    return sent >= 0;
+}
+
+// receives a newline-terminated message, and any descriptors passed along with it.
+// returns false if the connection ends before the newline.
+static bool receiveDescriptors(int connection, std::string& message, std::vector<int>& fds) {
+    char data[1024];
+    while (message.find('\n') == std::string::npos) {
+        union {
+            char buffer[CMSG_SPACE(sizeof(int) * 4)];
+            struct cmsghdr align;
+        } control;
+        struct iovec iov = { .iov_base = data, .iov_len = sizeof(data) };
+        struct msghdr header = {};
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1;
+        header.msg_control = control.buffer;
+        header.msg_controllen = sizeof(control.buffer);
+
+        ssize_t received = recvmsg(connection, &header, MSG_CMSG_CLOEXEC);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                fds.push_back(fd);
+            }
+        }
+        message.append(data, received);
+    }
+    message.resize(message.find('\n'));
+    return true;
+}
+
+// unbuffered output to a file descriptor, used to report errors to the clients of the daemon
+class DescriptorStreambuf: public std::streambuf {
+    public:
+        explicit DescriptorStreambuf(int fd): fd(fd) {}
+    protected:
+        int overflow(int c) override {
+            if (c == traits_type::eof()) return traits_type::not_eof(c);
+            char character = (char) c;
+            return xsputn(&character, 1) == 1 ? c : traits_type::eof();
+        }
+        std::streamsize xsputn(const char* data, std::streamsize count) override {
+            std::streamsize done = 0;
+            while (done < count) {
+                ssize_t written = write(fd, data + done, count - done);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) break;
+                done += written;
+            }
+            return done;
+        }
+    private:
+        int fd;
+};
+
+// io_uring user data for the operations on stdin. fifo polls use their index.
+static const uint64_t uringStdin = UINT64_MAX;
+static const uint64_t uringCancel = UINT64_MAX - 1;
+
+template <typename T>
+void Command::readLoop(Ringbuffer<T>* buffer, const std::vector<Command*>& controls, const std::function<void()>& processAll) {
     fd_set read_fds;
     struct timeval tv = { .tv_sec = 10, .tv_usec = 0};
     int rc;
-    size_t bytes_read;
+    ssize_t bytes_read = 0;
+    // result of the last io_uring read on stdin
+    ssize_t uring_result = 0;
     size_t read_over = 0;
-    int nfds = fileno(stdin) + 1;
+    int in = getInputFd();
+    int nfds = in + 1;
+
+    bool pipe = isPipe(in);
+    if (pipe) raisePipeSize(in);
+    std::unique_ptr<IoUring> uring;
+    if (*getGlobals()->get_option("--io-uring")) {
+        try {
+            uring.reset(new IoUring());
+            // both are optional optimizations, so failures are not a problem
+            uring->registerFiles({in});
+            uring->registerBuffer(buffer->getPointer(0), 2 * buffer->getSize() * sizeof(T));
+        } catch (const std::runtime_error& e) {
+            getErrors() << "WARNING: " << e.what() << ", falling back to read()\n";
+        }
+    }
+    bool reading = false;
 
-    FILE* fifo = nullptr;
-    char* fifo_input = nullptr;
-    if (!fifoName.empty()) {
-        fifo = fopen(fifoName.c_str(), "r");
+    bool splicing = !uring && pipe && *getGlobals()->get_option("--splice");
+    if (splicing && buffer->getFd() == -1) {
+        getErrors() << "WARNING: buffer is not file backed, falling back to read()\n";
+        splicing = false;
+    }
+
+    auto inputSpace = [this, buffer, &read_over] {
+        size_t writeable = buffer->writeable();
+        // without backpressure, leave room for consumers that are still working on older data
+        if (!buffer->hasBackpressure()) writeable = std::min(writeable, buffer->getSize() / 2);
+        if (readBlockSize() > 0) writeable = std::min(readBlockSize(), writeable);
+        // compensate for byte to element alignment
+        return (writeable * sizeof(T)) - read_over;
+    };
+
+    // commands are looked up by index, since a chain may replace them while we are running (see Chain::replace())
+    std::vector<std::pair<FILE*, size_t>> fifos;
+    for (size_t i = 0; i < controls.size(); i++) {
+        if (controls[i]->fifoName.empty()) continue;
+        FILE* fifo = fopen(controls[i]->fifoName.c_str(), "r");
         if (fifo == nullptr) {
-            std::cerr << "error opening fifo: " << strerror(errno) << "\n";
+            getErrors() << "error opening fifo: " << strerror(errno) << "\n";
         } else {
             fcntl(fileno(fifo), F_SETFL, O_NONBLOCK);
-            nfds = std::max(fileno(stdin), fileno(fifo)) + 1;
-            fifo_input = (char*) malloc(1024);
+            nfds = std::max(nfds, fileno(fifo) + 1);
+            fifos.emplace_back(fifo, i);
         }
     }
+    char* fifo_input = (char*) malloc(1024);
+    std::vector<bool> polling(fifos.size(), false);
 
     bool run = true;
     while (run) {
-        FD_ZERO(&read_fds);
-        FD_SET(fileno(stdin), &read_fds);
-        if (fifo) FD_SET(fileno(fifo), &read_fds);
-        tv.tv_sec = 10;
-        tv.tv_usec = 0;
+        // nobody will see the results anymore, for example when the client of a daemon has gone away
+        if (chain != nullptr && chain->isOutputClosed()) break;
+        // with backpressure, the buffer may be full. wait for the consumers to catch up
+        if (buffer->writeable() == 0) {
+            buffer->wait();
+            continue;
+        }
 
-        rc = select(nfds, &read_fds, NULL, NULL, &tv);
+        FD_ZERO(&read_fds);
+        if (uring) {
+            // a read on stdin and a poll on every fifo are kept in flight. one system call submits them and waits.
+            if (!reading) reading = uring->read(in, ((char *) buffer->getWritePointer()) + read_over, inputSpace(), uringStdin);
+            for (size_t i = 0; i < fifos.size(); i++) {
+                if (!polling[i]) polling[i] = uring->poll(fileno(fifos[i].first), POLLIN, i);
+            }
+            rc = uring->submit(1) ? 1 : -1;
+            uint64_t tag;
+            int result;
+            while (uring->complete(tag, result)) {
+                if (tag == uringStdin) {
+                    reading = false;
+                    uring_result = result;
+                    FD_SET(in, &read_fds);
+                } else if (tag < fifos.size()) {
+                    polling[tag] = false;
+                    FD_SET(fileno(fifos[tag].first), &read_fds);
+                }
+            }
+        } else if (fifos.empty()) {
+            // stdin is the only input, so a blocking read() is all we need
+            FD_SET(in, &read_fds);
+            rc = 1;
+        } else {
+            FD_SET(in, &read_fds);
+            for (auto& fifo : fifos) FD_SET(fileno(fifo.first), &read_fds);
+            tv.tv_sec = 10;
+            tv.tv_usec = 0;
+            rc = select(nfds, &read_fds, NULL, NULL, &tv);
+        }
         if (rc == -1) {
-            std::cerr << "select() error: " << strerror(errno) << "\n";
+            getErrors() << (uring ? "io_uring" : "select()") << " error: " << strerror(errno) << "\n";
             break;
         } else if (rc) {
-            if (fifo && FD_ISSET(fileno(fifo), &read_fds)) {
-                if (fgets(fifo_input, 1024, fifo) != NULL) {
-                    processFifoData(std::string(fifo_input, strlen(fifo_input) - 1));
+            for (auto& fifo : fifos) {
+                if (!FD_ISSET(fileno(fifo.first), &read_fds)) continue;
+                if (fgets(fifo_input, 1024, fifo.first) != NULL) {
+                    controls[fifo.second]->processFifoData(std::string(fifo_input, strlen(fifo_input) - 1));
                 } else {
-                    std::cerr << "WARNING: fifo returned from select(), but no data.\n";
+                    getErrors() << "WARNING: fifo returned from select(), but no data.\n";
                 }
             }
-            if (FD_ISSET(fileno(stdin), &read_fds)) {
-                // clamp so we don't overwrite the whole buffer in one go
-                size_t writeable = std::min((size_t) 1024, buffer->writeable());
-                // compensate for byte to element alignment
-                writeable = (writeable * sizeof(T)) - read_over;
-                bytes_read = read(fileno(stdin), ((char *) buffer->getWritePointer()) + read_over, writeable);
+            if (FD_ISSET(in, &read_fds)) {
+                size_t writeable = uring ? 0 : inputSpace();
+                if (uring) {
+                    // the read has completed already. io_uring reports errors as -errno.
+                    bytes_read = uring_result;
+                    if (bytes_read < 0) {
+                        errno = (int) -bytes_read;
+                        bytes_read = -1;
+                    }
+                } else if (splicing) {
+                    bytes_read = spliceInput(in, buffer, read_over, writeable);
+                    if (bytes_read < 0 && errno != EINTR && errno != EAGAIN) {
+                        // not every memory backend can be written to as a file (hugetlbfs, for example)
+                        getErrors() << "WARNING: splice() failed (" << strerror(errno) << "), falling back to read()\n";
+                        splicing = false;
+                        continue;
+                    }
+                } else {
+                    bytes_read = read(in, ((char *) buffer->getWritePointer()) + read_over, writeable);
+                }
                 if (bytes_read == 0) break;
+                if (bytes_read < 0) {
+                    if (errno == EINTR || errno == EAGAIN) continue;
+                    getErrors() << "error reading input: " << strerror(errno) << "\n";
+                    break;
+                }
 
                 // advance but don't go into partially read elements
                 buffer->advance((bytes_read + read_over) / sizeof(T));
                 read_over = (bytes_read + read_over) % sizeof(T);
 
-                // synchronous processing if we are not in async mode
-                if (runner == nullptr) {
-                    while (module->canProcess()) module->process();
-                }
+                if (processAll) processAll();
             }
         //} else {
             // no data, just timeout.
         }
 
-        if (fifo && feof(fifo)) {
-            std::cerr << "WARNING: fifo indicates EOF, terminating\n";
-            run = false;
+        for (auto& fifo : fifos) {
+            if (feof(fifo.first)) {
+                getErrors() << "WARNING: fifo indicates EOF, terminating\n";
+                run = false;
+            }
         }
+    }
 
+    if (reading) {
+        // the read must not complete into the buffer after we have returned
+        uring->cancel(uringStdin, uringCancel);
+        uint64_t tag;
+        int result;
+        while (reading && uring->submit(1)) {
+            while (uring->complete(tag, result)) {
+                if (tag == uringStdin) reading = false;
+            }
+        }
     }
 
-    if (fifo) {
-        fclose(fifo);
-        free(fifo_input);
+    for (auto& fifo : fifos) fclose(fifo.first);
+    free(fifo_input);
+}
+
+void Command::drain(const std::vector<UntypedModule*>& modules) {
+    // runners may still be working on buffered data after the input has ended.
+    // canProcess() blocks while a module is processing, so checking in order catches data in flight.
+    bool busy = true;
+    while (busy) {
+        busy = false;
+        for (UntypedModule* module : modules) {
+            if (!module->isSuspended() && module->canProcess()) {
+                busy = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                break;
+            }
+        }
     }
+}
 
-    delete buffer;
-    delete runner;
+void Command::finish(const std::vector<UntypedModule*>& modules, const std::function<void()>& settle) {
+    settle();
+    for (UntypedModule* module : modules) {
+        // what a module puts out here has to make it down the chain before the modules after it can finish
+        while (!module->isSuspended() && module->finish()) settle();
+    }
+}
+
+void Command::setChain(Chain* chain) {
+    this->chain = chain;
+}
+
+CLI::App* Command::getGlobals() {
+    if (chain != nullptr) return chain->getGlobals();
+    return get_parent();
+}
+
+int Command::getInputFd() {
+    if (chain != nullptr) return chain->getInputFd();
+    return fileno(stdin);
+}
+
+int Command::getOutputFd() {
+    if (chain != nullptr) return chain->getOutputFd();
+    return fileno(stdout);
+}
+
+std::ostream& Command::getErrors() {
+    if (chain != nullptr) return chain->getErrors();
+    return std::cerr;
+}
+
+RingbufferMemory Command::bufferMemory() {
+    if (*getGlobals()->get_option("--hugepages")) return RingbufferMemory::HUGEPAGES;
+    return RingbufferMemory::MEMFD;
 }
 
 template<typename T>
 void Command::runSource(Source<T>* source) {
-    auto writer = new StdoutWriter<T>();
+    if (chain != nullptr) {
+        getErrors() << "sources cannot be used in a chain\n";
+        return;
+    }
+
+    auto writer = stdoutWriter<T>();
+    if (writer == nullptr) return;
     source->setWriter(writer);
 
     bool run = true;
@@ -164,10 +739,691 @@ void Command::runSource(Source<T>* source) {
     }
 }
 
+// parses "N" or "MIN-MAX"
+static bool parseBlockSize(const std::string& value, size_t& minimum, size_t& maximum) {
+    char dash;
+    std::stringstream ss(value);
+    if (!(ss >> minimum) || minimum == 0) return false;
+    maximum = minimum;
+    if (ss >> dash && (dash != '-' || !(ss >> maximum) || maximum < minimum)) return false;
+    return ss.eof();
+}
+
+Command::Command(std::string name, std::string description): CLI::App(description, name) {
+    std::string group = "Thread placement";
+    add_option("--cpus", cpus, "CPUs to process on, e.g. 0,2-3")->group(group)->check([] (const std::string& value) {
+        try {
+            ThreadPolicy::parseCpus(value);
+        } catch (const std::invalid_argument& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    });
+    add_set("--scheduler", scheduler, {"other", "fifo", "rr"}, "Scheduling policy", true)->group(group);
+    add_option("--priority", priority, "Realtime priority for the fifo and rr policies", true)->group(group);
+
+    group = "Block size";
+    add_option("--block-size", blockSize, "Samples per processing step. A range like 256-65536 enables automatic tuning")->group(group)->check([] (const std::string& value) {
+        size_t minimum, maximum;
+        if (!parseBlockSize(value, minimum, maximum)) return std::string("invalid block size: \"" + value + "\"");
+        return std::string();
+    });
+    add_option("--block-latency", latency, "Maximum processing time per block in microseconds when tuning the block size", true)->group(group);
+}
+
+void Command::applyBlockSize(UntypedModule* module) {
+    size_t minimum, maximum;
+    if (!parseBlockSize(blockSize, minimum, maximum)) return;
+    if (minimum == maximum) {
+        module->setBlockSizePolicy(BlockSizePolicy(minimum));
+    } else {
+        module->setBlockSizePolicy(BlockSizePolicy(minimum, maximum, latency));
+    }
+}
+
+size_t Command::readBlockSize() {
+    size_t minimum, maximum;
+    if (!parseBlockSize(blockSize, minimum, maximum)) return 0;
+    return maximum;
+}
+
+template <typename T>
+Writer<T>* Command::stdoutWriter() {
+    auto globals = getGlobals();
+    // the output was explicitly meant to go elsewhere, so there is no falling back to stdout
+    if (*globals->get_option("--shm-output")) return shareOutput<T>(globals->get_option("--shm-output")->as<std::string>());
+    bool ioUring = (bool) *globals->get_option("--io-uring");
+    bool threaded = ioUring || *globals->get_option("--output-thread");
+    if (!threaded && !*globals->get_option("--coalesce")) return new StdoutWriter<T>(getOutputFd(), 10240);
+
+    size_t flushSize = globals->get_option("--flush-size")->as<size_t>() / sizeof(T);
+    std::chrono::milliseconds interval(globals->get_option("--flush-interval")->as<unsigned int>());
+    OverflowPolicy overflow = OverflowPolicy::BLOCK;
+    if (globals->get_option("--output-overflow")->as<std::string>() == "drop") overflow = OverflowPolicy::DROP;
+    return new BufferedWriter<T>(getOutputFd(), flushSize, interval, threaded, overflow, ioUring);
+}
+
+template <typename T>
+SharedRingbuffer<T>* Command::shareOutput(const std::string& path) {
+    SharedRingbuffer<T>* buffer;
+    try {
+        buffer = new SharedRingbuffer<T>(bufferSize());
+    } catch (const BufferError& e) {
+        getErrors() << e.what() << "\n";
+        return nullptr;
+    }
+
+    int listener = listenSocket(path);
+    if (listener < 0) {
+        delete buffer;
+        return nullptr;
+    }
+    // like opening a fifo, this waits for the other side
+    int connection;
+    do {
+        connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    } while (connection < 0 && errno == EINTR);
+    bool sent = connection >= 0 && sendDescriptors(connection, typeName<T>() + "\n", {buffer->getFd()});
+    if (!sent) getErrors() << "unable to hand over shared memory: " << strerror(errno) << "\n";
+    // the reader confirms that it has attached. otherwise we would wait for it forever.
+    char confirmation;
+    bool attached = sent && read(connection, &confirmation, 1) == 1;
+    if (sent && !attached) getErrors() << "the other process did not attach to the shared memory\n";
+    if (connection >= 0) close(connection);
+    close(listener);
+    unlink(path.c_str());
+    if (!attached) {
+        delete buffer;
+        return nullptr;
+    }
+    return buffer;
+}
+
+template <typename T>
+SharedRingbufferReader<T>* Command::sharedInput() {
+    auto path = getGlobals()->get_option("--shm-input")->as<std::string>();
+    // the producer may not have started listening yet
+    int connection = connectSocket(path, std::chrono::seconds(10));
+    if (connection < 0) return nullptr;
+    std::string message;
+    std::vector<int> fds;
+    SharedRingbufferReader<T>* reader = nullptr;
+    if (!receiveDescriptors(connection, message, fds) || fds.size() != 1) {
+        getErrors() << "did not receive shared memory from " << path << "\n";
+        for (int fd : fds) close(fd);
+    } else if (message != typeName<T>()) {
+        getErrors() << "shared memory from " << path << " contains " << message << ", but " << get_name() << " expects " << typeName<T>() << "\n";
+        close(fds[0]);
+    } else {
+        try {
+            reader = new SharedRingbufferReader<T>(fds[0]);
+            // lets the writer start
+            if (send(connection, "\n", 1, MSG_NOSIGNAL) != 1) {
+                delete reader;
+                reader = nullptr;
+            }
+        } catch (const BufferError& e) {
+            getErrors() << e.what() << "\n";
+        }
+    }
+    close(connection);
+    return reader;
+}
+
+template <typename T>
+void Command::readShared(SharedRingbufferReader<T>* reader, const std::function<void()>& processAll) {
+    if (!processAll) {
+        // the runners do all the work
+        reader->waitForClose();
+        return;
+    }
+    bool closed = false;
+    while (!closed) {
+        // anything written before the close must still be processed
+        closed = reader->isClosed();
+        processAll();
+        if (!closed) reader->wait();
+    }
+}
+
+MappedFile* Command::mapInput() {
+    auto path = getGlobals()->get_option("--input")->as<std::string>();
+    try {
+        return new MappedFile(path);
+    } catch (const std::runtime_error& e) {
+        getErrors() << e.what() << "\n";
+        return nullptr;
+    }
+}
+
 CLI::Option* Command::addFifoOption() {
     return add_option("--fifo", fifoName, "Control fifo");
 }
 
+ThreadPolicy Command::threadPolicy() {
+    ThreadPolicy policy;
+    if (!cpus.empty()) policy.setCpus(ThreadPolicy::parseCpus(cpus));
+    policy.setScheduler(ThreadPolicy::parseScheduler(scheduler), priority);
+    return policy;
+}
+
+StatisticsReporter* Command::startStatistics(std::vector<std::pair<std::string, UntypedModule*>> modules) {
+    std::string path;
+    unsigned int interval = 1000;
+    auto globals = getGlobals();
+    if (!*globals->get_option("--stats")) return nullptr;
+    path = globals->get_option("--stats")->as<std::string>();
+    interval = globals->get_option("--stats-interval")->as<unsigned int>();
+    return new StatisticsReporter(path, interval, std::move(modules));
+}
+
+StatisticsReporter::StatisticsReporter(std::string path, unsigned int interval, std::vector<std::pair<std::string, UntypedModule*>> modules):
+    path(std::move(path)),
+    interval(interval),
+    modules(std::move(modules)),
+    thread([this] { loop(); })
+{}
+
+StatisticsReporter::~StatisticsReporter() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        run = false;
+    }
+    stateCondition.notify_all();
+    thread.join();
+    report();
+    if (fd >= 0) close(fd);
+}
+
+void StatisticsReporter::replaceModule(size_t index, std::string name, UntypedModule* module) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    modules[index] = std::make_pair(std::move(name), module);
+}
+
+void StatisticsReporter::loop() {
+    // a reader closing the fifo must not take down the whole process. the signal stays pending on this thread only.
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    while (run) {
+        stateCondition.wait_for(lock, interval);
+        if (!run) break;
+        report();
+    }
+}
+
+void StatisticsReporter::report() {
+    if (fd < 0) {
+        // a fifo without a reader fails to open here. we'll try again with the next report.
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+    }
+
+    std::stringstream ss;
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    ss << "{\"timestamp\":" << now << ",\"modules\":[";
+    for (size_t i = 0; i < modules.size(); i++) {
+        ModuleStatistics stats = modules[i].second->getStatistics();
+        if (i > 0) ss << ",";
+        ss << "{\"stage\":" << i + 1
+           << ",\"name\":\"" << modules[i].first << "\""
+           << ",\"samples_in\":" << stats.samplesIn
+           << ",\"samples_out\":" << stats.samplesOut
+           << ",\"process_calls\":" << stats.processCalls
+           << ",\"process_ns\":" << stats.processNanoseconds
+           << ",\"process_histogram\":[";
+        for (size_t k = 0; k < ModuleStatistics::HISTOGRAM_BUCKETS; k++) {
+            if (k > 0) ss << ",";
+            ss << stats.processHistogram[k];
+        }
+        ss << "],\"wait_ns\":" << stats.waitNanoseconds
+           << ",\"input_fill\":" << stats.inputFill
+           << ",\"input_fill_high_water\":" << stats.inputFillHighWater
+           << "}";
+    }
+    ss << "]}\n";
+
+    std::string line = ss.str();
+    ssize_t written = write(fd, line.c_str(), line.length());
+    if (written < 0 && errno != EAGAIN) {
+        // the reader has gone away. reopen on the next report.
+        close(fd);
+        fd = -1;
+    }
+}
+
+template <typename T>
+void Command::prepareBuffer(Ringbuffer<T>* buffer) {
+    if (*getGlobals()->get_option("--mlock")) {
+        ThreadPolicy::lockMemory();
+        buffer->prefault();
+    }
+}
+
+Chain::Chain(std::vector<std::vector<std::string>> descriptions, std::function<void(CLI::App&)> commandFactory, CLI::App* globals, unsigned int threads, ThreadPolicy policy, int inputFd, int outputFd, std::ostream& errors):
+    descriptions(std::move(descriptions)),
+    commandFactory(std::move(commandFactory)),
+    globals(globals),
+    threads(threads),
+    policy(std::move(policy)),
+    inputFd(inputFd),
+    outputFd(outputFd),
+    errors(errors)
+{}
+
+Chain::~Chain() {
+    for (UntypedChainStage* stage : stages) {
+        delete stage->getModule();
+        delete stage;
+    }
+}
+
+std::vector<std::vector<std::string>> Chain::parse(const std::string& description, std::ostream& errors) {
+    std::vector<std::vector<std::string>> descriptions;
+    std::stringstream stages(description);
+    std::string stage;
+    while (std::getline(stages, stage, '|')) {
+        std::stringstream words(stage);
+        std::vector<std::string> args;
+        std::string word;
+        while (words >> word) args.push_back(word);
+        if (args.empty()) {
+            errors << "empty stage in chain description\n";
+            return {};
+        }
+        descriptions.push_back(args);
+    }
+    if (descriptions.empty()) {
+        errors << "no chain description given\n";
+    }
+    return descriptions;
+}
+
+CLI::App* Chain::getGlobals() {
+    return globals;
+}
+
+int Chain::getInputFd() {
+    return inputFd;
+}
+
+int Chain::getOutputFd() {
+    return outputFd;
+}
+
+std::ostream& Chain::getErrors() {
+    return errors;
+}
+
+bool Chain::isOutputClosed() {
+    return !stages.empty() && stages.back()->isOutputClosed();
+}
+
+void Chain::start() {
+    next();
+}
+
+void Chain::setControl(Command* control) {
+    this->control = control;
+}
+
+void Chain::addStage(UntypedChainStage* stage) {
+    if (replacing) {
+        replacement = stage;
+        return;
+    }
+    stages.push_back(stage);
+    // the stages are set up recursively so that the commands' callbacks (and anything they keep on the stack)
+    // stay alive until the whole chain has finished running
+    next();
+}
+
+void Chain::next() {
+    size_t index = stages.size();
+    if (index == descriptions.size()) {
+        run();
+        return;
+    }
+
+    CLI::App app;
+    commandFactory(app);
+    app.require_subcommand(1);
+    for (CLI::App* subcommand : app.get_subcommands([] (CLI::App*) { return true; })) {
+        auto command = dynamic_cast<Command*>(subcommand);
+        if (command != nullptr) command->setChain(this);
+    }
+
+    std::vector<std::string> args(descriptions[index].rbegin(), descriptions[index].rend());
+    try {
+        app.parse(args);
+    } catch (const CLI::ParseError& e) {
+        errors << "error in chain stage " << index + 1 << ":\n";
+        app.exit(e, errors, errors);
+        return;
+    }
+
+    if (stages.size() == index) {
+        errors << "chain stage " << index + 1 << " (" << descriptions[index][0] << ") did not provide a module\n";
+    }
+}
+
+void Chain::run() {
+    MappedFile* file = nullptr;
+    if (*globals->get_option("--input")) {
+        // must happen before connecting, since it rules out in-place processing on the first stage
+        file = stages.front()->getCommand()->mapInput();
+        if (file == nullptr) return;
+        stages.front()->readFile(file);
+    } else if (*globals->get_option("--shm-input")) {
+        if (!stages.front()->readShared()) return;
+    }
+
+    for (size_t i = 0; i + 1 < stages.size(); i++) {
+        if (!stages[i]->connect(stages[i + 1])) {
+            errors << "chain stage " << i + 1 << " produces " << stages[i]->getOutputType() << ", but stage " << i + 2
+                      << " expects " << stages[i + 1]->getInputType() << "\n";
+            return;
+        }
+    }
+    if (!stages.back()->connectStdout()) {
+        delete file;
+        return;
+    }
+
+    if (*globals->get_option("--mlock")) {
+        ThreadPolicy::lockMemory();
+        for (UntypedChainStage* stage : stages) stage->prefault();
+    }
+
+    std::vector<ThreadPolicy> policies;
+    for (UntypedChainStage* stage : stages) {
+        modules.push_back(stage->getModule());
+        controls.push_back(stage->getCommand());
+        ThreadPolicy stagePolicy = stage->getCommand()->threadPolicy();
+        policies.push_back(stagePolicy.isDefault() ? policy : stagePolicy);
+    }
+
+    std::vector<std::pair<std::string, UntypedModule*>> named;
+    for (size_t i = 0; i < modules.size(); i++) named.emplace_back(controls[i]->get_name(), modules[i]);
+    stats = stages.front()->getCommand()->startStatistics(named);
+    if (control != nullptr) controls.push_back(control);
+
+    std::function<void()> processAll = nullptr;
+    if (threads > 0) {
+        // stages with the same policy share a pool
+        std::vector<ThreadPolicy> pools;
+        for (size_t i = 0; i < modules.size(); i++) {
+            size_t pool = std::find(pools.begin(), pools.end(), policies[i]) - pools.begin();
+            if (pool == pools.size()) {
+                pools.push_back(policies[i]);
+                unsigned int poolThreads = threads;
+                if (!policies[i].getCpus().empty()) poolThreads = std::min(poolThreads, (unsigned int) policies[i].getCpus().size());
+                executors.push_back(new Executor(poolThreads, policies[i]));
+            }
+            stageExecutors.push_back(executors[pool]);
+            executors[pool]->addModule(modules[i]);
+        }
+    } else if (*globals->get_option("--async")) {
+        for (size_t i = 0; i < modules.size(); i++) runners.push_back(new AsyncRunner(modules[i], policies[i]));
+    } else {
+        // everything runs on this thread, so only the chain's own policy can be honored
+        policy.apply();
+        processAll = [this] {
+            // keep going until all data has travelled as far down the chain as it can
+            bool progress = true;
+            while (progress) {
+                progress = false;
+                for (UntypedModule* module : modules) {
+                    while (!module->isSuspended() && module->canProcess()) {
+                        module->processTimed();
+                        progress = true;
+                    }
+                }
+                if (!progress) progress = stages.back()->waitForOutput();
+            }
+        };
+    }
+
+    if (file != nullptr) {
+        if (*globals->get_option("--parallel")) {
+            if (processAll) {
+                // the downstream stages have to run while the first stage is busy
+                errors << "WARNING: parallel processing in a chain requires --async or --threads\n";
+            } else if (!stages.front()->processSegmented(globals->get_option("--parallel")->as<unsigned int>())) {
+                errors << "WARNING: " << controls.front()->get_name() << " cannot process in parallel\n";
+            }
+        }
+        if (processAll) processAll();
+    } else {
+        stages.front()->readInput(controls, processAll);
+    }
+
+    if (processAll) {
+        Command::finish(modules, processAll);
+    } else {
+        Command::finish(modules, [this] { Command::drain(modules); });
+    }
+    delete stats;
+    stats = nullptr;
+    for (AsyncRunner* runner : runners) delete runner;
+    for (Executor* executor : executors) delete executor;
+    runners.clear();
+    stageExecutors.clear();
+    executors.clear();
+    modules.clear();
+    controls.clear();
+    delete file;
+}
+
+bool Chain::replace(size_t index, const std::vector<std::string>& description) {
+    if (index >= modules.size()) {
+        errors << "cannot replace chain stage " << index + 1 << ": the chain has " << modules.size() << " running stages\n";
+        return false;
+    }
+
+    std::unique_ptr<CLI::App> app(new CLI::App());
+    commandFactory(*app);
+    app->require_subcommand(1);
+    for (CLI::App* subcommand : app->get_subcommands([] (CLI::App*) { return true; })) {
+        auto command = dynamic_cast<Command*>(subcommand);
+        if (command != nullptr) command->setChain(this);
+    }
+
+    std::vector<std::string> args(description.rbegin(), description.rend());
+    replacing = true;
+    replacement = nullptr;
+    try {
+        app->parse(args);
+    } catch (const CLI::ParseError& e) {
+        // stdout carries our output, so help and errors both go to stderr
+        errors << "error in replacement for chain stage " << index + 1 << ": " << e.what() << "\n";
+    }
+    replacing = false;
+    UntypedChainStage* stage = replacement;
+    replacement = nullptr;
+    if (stage == nullptr) {
+        errors << "replacement for chain stage " << index + 1 << " (" << description[0] << ") did not provide a module\n";
+        return false;
+    }
+
+    UntypedChainStage* previous = stages[index];
+    if (stage->getInputType() != previous->getInputType() || stage->getOutputType() != previous->getOutputType()) {
+        errors << "chain stage " << index + 1 << " works on " << previous->getInputType() << " to " << previous->getOutputType()
+                  << ", but " << description[0] << " works on " << stage->getInputType() << " to " << stage->getOutputType() << "\n";
+        delete stage->getModule();
+        delete stage;
+        return false;
+    }
+
+    stopModule(index);
+    if (!stage->takeOver(previous)) {
+        errors << "chain stage " << index + 1 << " works in place, but " << description[0] << " cannot\n";
+        startModule(index);
+        delete stage->getModule();
+        delete stage;
+        return false;
+    }
+    stages[index] = stage;
+    modules[index] = stage->getModule();
+    // the control fifo of the stage now steers the new command
+    controls[index] = stage->getCommand();
+    if (stats != nullptr) stats->replaceModule(index, stage->getCommand()->get_name(), modules[index]);
+    startModule(index);
+
+    delete previous->getModule();
+    delete previous;
+    // a command set up by next() is still on the stack, anything set up here can go along with its module
+    if (replacementApps.size() < stages.size()) replacementApps.resize(stages.size());
+    replacementApps[index] = std::move(app);
+    return true;
+}
+
+bool Chain::isReplacing() {
+    return replacing;
+}
+
+void Chain::startModule(size_t index) {
+    if (!stageExecutors.empty()) {
+        stageExecutors[index]->addModule(modules[index]);
+    } else if (!runners.empty()) {
+        ThreadPolicy stagePolicy = stages[index]->getCommand()->threadPolicy();
+        runners[index] = new AsyncRunner(modules[index], stagePolicy.isDefault() ? policy : stagePolicy);
+    }
+    // in synchronous mode, the next call to processAll() picks up the new module
+}
+
+void Chain::stopModule(size_t index) {
+    if (!stageExecutors.empty()) {
+        stageExecutors[index]->removeModule(modules[index]);
+    } else if (!runners.empty()) {
+        delete runners[index];
+        runners[index] = nullptr;
+    }
+}
+
+ChainCommand::ChainCommand(std::function<void(CLI::App&)> commandFactory): Command("chain", "Run multiple commands within one process") {
+    add_option("-t,--threads", threads, "Run the chain on a pool of worker threads instead of one thread per module");
+    addFifoOption();
+    // everything after the options is the chain description
+    prefix_command();
+    callback( [this, commandFactory] () {
+        std::string description;
+        for (const std::string& arg : remaining()) description += arg + " ";
+
+        auto descriptions = Chain::parse(description);
+        if (descriptions.empty()) return;
+
+        Chain chain(descriptions, commandFactory, get_parent(), threads, threadPolicy());
+        chain.setControl(this);
+        running = &chain;
+        chain.start();
+        running = nullptr;
+    });
+}
+
+void ChainCommand::processFifoData(std::string data) {
+    // "replace <stage> <command> [args...]", with stages counted from 1
+    std::stringstream words(data);
+    std::string action;
+    size_t stage = 0;
+    words >> action >> stage;
+    if (action != "replace" || stage == 0) {
+        getErrors() << "invalid chain control \"" << data << "\"\n";
+        return;
+    }
+    std::string description;
+    std::getline(words, description);
+    auto descriptions = Chain::parse(description, getErrors());
+    if (descriptions.size() != 1) {
+        if (!descriptions.empty()) getErrors() << "a chain stage can only be replaced by a single command\n";
+        return;
+    }
+    if (running != nullptr) running->replace(stage - 1, descriptions.front());
+}
+
+DaemonCommand::DaemonCommand(std::function<void(CLI::App&)> commandFactory): Command("daemon", "Run chains for clients connecting to a Unix socket") {
+    add_option("-s,--socket", socketPath, "Path of the socket to listen on")->required();
+    add_option("-t,--threads", threads, "Run each chain on a pool of worker threads instead of one thread per module");
+    callback( [this, commandFactory] () {
+        if (*get_parent()->get_option("--input") || *get_parent()->get_option("--shm-input") || *get_parent()->get_option("--shm-output")) {
+            std::cerr << "--input, --shm-input and --shm-output cannot be used with the daemon\n";
+            return;
+        }
+
+        int listener = listenSocket(socketPath);
+        if (listener < 0) return;
+
+        // a client that goes away must not take all the other chains down with it. its chain notices the failing
+        // writes and ends (see Chain::isOutputClosed()).
+        signal(SIGPIPE, SIG_IGN);
+
+        while (true) {
+            int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                std::cerr << "error accepting connection: " << strerror(errno) << "\n";
+                break;
+            }
+            std::thread([this, connection, commandFactory] {
+                serve(connection, commandFactory);
+            }).detach();
+        }
+        close(listener);
+    });
+}
+
+void DaemonCommand::serve(int connection, const std::function<void(CLI::App&)>& commandFactory) {
+    std::string description;
+    std::vector<int> fds;
+    if (!receiveDescriptors(connection, description, fds)) {
+        std::cerr << "client disconnected before sending a chain description\n";
+    } else if (fds.size() != 2 && fds.size() != 3) {
+        std::cerr << "client passed " << fds.size() << " descriptors, expected input, output and optionally stderr\n";
+    } else {
+        // errors go to the client, unless it has kept its stderr to itself
+        DescriptorStreambuf clientErrors(fds.size() == 3 ? fds[2] : STDERR_FILENO);
+        std::ostream errors(&clientErrors);
+        auto descriptions = Chain::parse(description, errors);
+        if (!descriptions.empty()) {
+            Chain chain(descriptions, commandFactory, get_parent(), threads, threadPolicy(), fds[0], fds[1], errors);
+            chain.start();
+        }
+    }
+
+    for (int fd : fds) close(fd);
+    // tells the client that the chain has ended
+    close(connection);
+}
+
+ConnectCommand::ConnectCommand(): Command("connect", "Run a chain on a daemon, passing on stdin and stdout") {
+    add_option("-s,--socket", socketPath, "Path of the daemon's socket")->required();
+    // everything after the options is the chain description
+    prefix_command();
+    callback( [this] () {
+        std::string description;
+        for (const std::string& arg : remaining()) description += arg + " ";
+
+        int connection = connectSocket(socketPath);
+        if (connection < 0) return;
+        if (!sendDescriptors(connection, description + "\n", {fileno(stdin), fileno(stdout), fileno(stderr)})) {
+            std::cerr << "unable to send chain to daemon: " << strerror(errno) << "\n";
+            close(connection);
+            return;
+        }
+
+        // the daemon holds on to our stdin and stdout. we just have to stay around until it is done with them.
+        char c;
+        ssize_t rc;
+        do {
+            rc = read(connection, &c, 1);
+        } while (rc > 0 || (rc < 0 && errno == EINTR));
+        close(connection);
+    });
+}
+
 AgcCommand::AgcCommand(): Command("agc", "Automatic gain control") {
     add_set("-f,--format", format, {"s16", "float", "complex"}, "Data format", true);
     add_set("-p,--profile", profile, {"fast", "slow"}, "AGC profile", true);
@@ -185,7 +1441,7 @@ AgcCommand::AgcCommand(): Command("agc", "Automatic gain control") {
         } else if (format == "complex") {
             runAgc<complex<float>>();
         } else {
-            std::cerr << "invalid format: " << format << "\n";
+            getErrors() << "invalid format: " << format << "\n";
         }
     });
 }
@@ -235,14 +1491,14 @@ ConvertCommand::ConvertCommand(): Command("convert", "Convert between stream for
     add_set("-o,--outformat", outFormat, {"s16", "float", "char"}, "Output data format", true);
     callback( [this] () {
         if (inFormat == outFormat) {
-            std::cerr << "input and output format are identical, cannot convert\n";
+            getErrors() << "input and output format are identical, cannot convert\n";
             return;
         }
         if (inFormat == "s16") {
             if (outFormat == "float") {
                 runModule(new Converter<short, float>());
             } else {
-                std::cerr << "unable to handle output format \"" << outFormat << "\"\n";
+                getErrors() << "unable to handle output format \"" << outFormat << "\"\n";
             }
         } else if (inFormat == "float") {
             if (outFormat == "s16") {
@@ -250,16 +1506,16 @@ ConvertCommand::ConvertCommand(): Command("convert", "Convert between stream for
             } else if (outFormat == "char") {
                 runModule(new Converter<float, unsigned char>());
             } else {
-                std::cerr << "unable to handle output format \"" << outFormat << "\"\n";
+                getErrors() << "unable to handle output format \"" << outFormat << "\"\n";
             }
         } else if (inFormat == "char") {
             if (outFormat == "float") {
                 runModule(new Converter<unsigned char, float>());
             } else {
-                std::cerr << "unable to handle output format \"" << outFormat << "\"\n";
+                getErrors() << "unable to handle output format \"" << outFormat << "\"\n";
             }
         } else {
-            std::cerr << "unable to handle input format \"" << inFormat << "\"\n";
+            getErrors() << "unable to handle input format \"" << inFormat << "\"\n";
         }
     });
 }
@@ -270,7 +1526,7 @@ FftCommand::FftCommand(): Command("fft", "Fast Fourier transformation") {
     add_set("-w,--window", window, {"boxcar", "blackman", "hamming"}, "Window function", true);
     callback( [this] () {
         if (!isPowerOf2(fftSize)) {
-            std::cerr << "FFT size must be power of 2\n";
+            getErrors() << "FFT size must be power of 2\n";
             return;
         }
         Window* w;
@@ -281,7 +1537,7 @@ FftCommand::FftCommand(): Command("fft", "Fast Fourier transformation") {
         } else if (window == "hamming") {
             w = new HammingWindow();
         } else {
-            std::cerr << "window type \"" << window << "\" not available\n";
+            getErrors() << "window type \"" << window << "\" not available\n";
             return;
         }
 
@@ -346,6 +1602,10 @@ FirDecimateCommand::FirDecimateCommand(): Command("firdecimate", "Decimate and f
     add_option("transition_bw", transitionBandwidth, "Transition bandwidth", true);
     add_option("-c,--cutoff", cutoffRate, "Cutoff rate", true);
     add_set("-w,--window", window, {"boxcar", "blackman", "hamming"}, "Window function", true);
+    auto multistageFlag = add_flag("-m,--multistage", multistage, "Decimate in several stages (halfband filters first), which is much cheaper for large decimation factors");
+    auto fftFlag = add_flag("-f,--fft", use_fft, "Filter and decimate in the frequency domain, which is much cheaper for long filters");
+    multistageFlag->excludes(fftFlag);
+    fftFlag->excludes(multistageFlag);
     callback( [this] () {
         Window* w;
         if (window == "boxcar") {
@@ -355,10 +1615,16 @@ FirDecimateCommand::FirDecimateCommand(): Command("firdecimate", "Decimate and f
         } else if (window == "hamming") {
             w = new HammingWindow();
         } else {
-            std::cerr << "window type \"" << window << "\" not available\n";
+            getErrors() << "window type \"" << window << "\" not available\n";
             return;
         }
-        runModule(new FirDecimate(decimationFactor, transitionBandwidth, w, cutoffRate));
+        if (multistage) {
+            runModule(new MultistageDecimator(decimationFactor, transitionBandwidth, w, cutoffRate));
+        } else if (use_fft) {
+            runModule(new FftDecimator(decimationFactor, transitionBandwidth, w, cutoffRate));
+        } else {
+            runModule(new FirDecimate(decimationFactor, transitionBandwidth, w, cutoffRate));
+        }
     });
 }
 
@@ -381,7 +1647,7 @@ FractionalDecimatorCommand::FractionalDecimatorCommand(): Command("fractionaldec
         } else if (format == "complex") {
             runDecimator<complex<float>>();
         } else {
-            std::cerr << "invalid format \"" << format << "\"\n";
+            getErrors() << "invalid format \"" << format << "\"\n";
         }
     });
 }
@@ -398,7 +1664,7 @@ void FractionalDecimatorCommand::runDecimator() {
         } else if (window == "hamming") {
             w = new HammingWindow();
         } else {
-            std::cerr << "window type \"" << window << "\" not available\n";
+            getErrors() << "window type \"" << window << "\" not available\n";
             return;
         }
         filter = new LowPassFilter<T>(0.5 / (decimation_rate - transition), transition, w);
@@ -406,6 +1672,27 @@ void FractionalDecimatorCommand::runDecimator() {
     runModule(new FractionalDecimator<T>(decimation_rate, num_poly_points, filter));
 }
 
+CicDecimateCommand::CicDecimateCommand(): Command("cicdecimate", "Decimate with a CIC filter") {
+    add_option("ratio", ratio, "Decimation ratio")->required();
+    add_option("-n,--order", order, "Number of integrator and comb stages", true);
+    add_set("-i,--informat", format, {"float", "s16"}, "Input format (complex samples)", true);
+    add_option("-p,--passband", passband, "Edge of the compensated passband, relative to the output rate", true);
+    add_option("-t,--taps", taps, "Length of the compensation filter. 0 disables it", true);
+    callback( [this] () {
+        try {
+            if (format == "float") {
+                runModule(new CicDecimator<complex<float>>(ratio, order, passband, taps));
+            } else if (format == "s16") {
+                runModule(new CicDecimator<complex<short>>(ratio, order, passband, taps));
+            } else {
+                getErrors() << "invalid format \"" << format << "\"\n";
+            }
+        } catch (const std::runtime_error& e) {
+            getErrors() << e.what() << "\n";
+        }
+    });
+}
+
 AdpcmCommand::AdpcmCommand(): Command("adpcm", "ADPCM codec") {
     auto decodeFlag = add_flag("-d,--decode", decode, "Decode ADPCM data");
     auto encodeFlag = add_flag("-e,--encode", encode, "Encode into ADPCM data");
@@ -437,28 +1724,46 @@ LimitCommand::LimitCommand(): Command("limit", "Limit stream values to maximum a
     });
 }
 
+// writes every n-th measurement to a fifo. it belongs to the module's callback, since the module can outlive the command
+// callback that set it up when it replaces a chain stage. the fifo is closed once the module is deleted.
+class FifoReporter {
+    public:
+        FifoReporter(FILE* fifo, unsigned int interval): fifo(fifo), interval(interval), counter(interval) {}
+        ~FifoReporter() {
+            fclose(fifo);
+        }
+        void report(float value) {
+            if (--counter <= 0) {
+                fprintf(fifo, "%g\n", value);
+                fflush(fifo);
+                counter = interval;
+            }
+        }
+    private:
+        FILE* fifo;
+        unsigned int interval;
+        int counter;
+};
+
+static std::shared_ptr<FifoReporter> openReporter(const std::string& path, unsigned int interval, std::ostream& errors) {
+    FILE* fifo = fopen(path.c_str(), "w");
+    if (fifo == nullptr) {
+        errors << "error opening fifo: " << strerror(errno) << "\n";
+        return nullptr;
+    }
+    fcntl(fileno(fifo), F_SETFL, O_NONBLOCK);
+    return std::make_shared<FifoReporter>(fifo, interval);
+}
+
 PowerCommand::PowerCommand(): Command("power", "Measure power") {
     add_option("-o,--outfifo", outFifoName, "Control fifo")->required();
     add_option("length", length, "Number of samples to measure power over", true);
     add_option("decimation", decimation, "Decimate data when calculating power", true);
     add_option("report_every", reportInterval, "Reporting interval", true);
     callback( [this] () {
-        int reportCounter = reportInterval;
-        FILE* outFifo = fopen(outFifoName.c_str(), "w");
-        if (outFifo == nullptr) {
-            std::cerr << "error opening fifo: " << strerror(errno) << "\n";
-            return;
-        } else {
-            fcntl(fileno(outFifo), F_SETFL, O_NONBLOCK);
-        }
-        runModule(new Power<complex<float>>(length, decimation, [this, &reportCounter, outFifo] (float power) {
-            if (--reportCounter <= 0) {
-                fprintf(outFifo, "%g\n", power);
-                fflush(outFifo);
-                reportCounter = reportInterval;
-            }
-        }));
-        fclose(outFifo);
+        auto reporter = openReporter(outFifoName, reportInterval, getErrors());
+        if (reporter == nullptr) return;
+        runModule(new Power<complex<float>>(length, decimation, [reporter] (float power) { reporter->report(power); }));
     });
 }
 
@@ -471,23 +1776,10 @@ SquelchCommand::SquelchCommand(): Command("squelch", "Measure power and apply sq
     add_option("flushLength", flushLength, "Number of samples to flush once squelch closes", true);
     add_option("report_every", reportInterval, "Reporting interval", true);
     callback( [this] () {
-        int reportCounter = reportInterval;
-        FILE* outFifo = fopen(outFifoName.c_str(), "w");
-        if (outFifo == nullptr) {
-            std::cerr << "error opening fifo: " << strerror(errno) << "\n";
-            return;
-        } else {
-            fcntl(fileno(outFifo), F_SETFL, O_NONBLOCK);
-        }
-        squelch = new Squelch<complex<float>>(length, decimation, hangLength, flushLength, [this, &reportCounter, outFifo] (float power) {
-            if (--reportCounter <= 0) {
-                fprintf(outFifo, "%g\n", power);
-                fflush(outFifo);
-                reportCounter = reportInterval;
-            }
-        });
+        auto reporter = openReporter(outFifoName, reportInterval, getErrors());
+        if (reporter == nullptr) return;
+        squelch = new Squelch<complex<float>>(length, decimation, hangLength, flushLength, [reporter] (float power) { reporter->report(power); });
         runModule(squelch);
-        fclose(outFifo);
     });
 }
 
@@ -501,22 +1793,9 @@ SnrCommand::SnrCommand(): Command("snr", "Measure signal-to-noise ratio") {
     add_option("fft_size", fftSize, "Size of the FFT being used", true);
     add_option("report_every", reportInterval, "Reporting interval", true);
     callback( [this] () {
-        int reportCounter = reportInterval;
-        FILE* outFifo = fopen(outFifoName.c_str(), "w");
-        if (outFifo == nullptr) {
-            std::cerr << "error opening fifo: " << strerror(errno) << "\n";
-            return;
-        } else {
-            fcntl(fileno(outFifo), F_SETFL, O_NONBLOCK);
-        }
-        runModule(new Snr<complex<float>>(length, fftSize, [this, &reportCounter, outFifo] (float snr) {
-            if (--reportCounter <= 0) {
-                fprintf(outFifo, "%g\n", snr);
-                fflush(outFifo);
-                reportCounter = reportInterval;
-            }
-        }));
-        fclose(outFifo);
+        auto reporter = openReporter(outFifoName, reportInterval, getErrors());
+        if (reporter == nullptr) return;
+        runModule(new Snr<complex<float>>(length, fftSize, [reporter] (float snr) { reporter->report(snr); }));
     });
 }
 
@@ -529,23 +1808,10 @@ SnrSquelchCommand::SnrSquelchCommand(): Command("snrsquelch", "Measure signal-to
     add_option("flushLength", flushLength, "Number of samples to flush once squelch closes", true);
     add_option("report_every", reportInterval, "Reporting interval", true);
     callback( [this] () {
-        int reportCounter = reportInterval;
-        FILE* outFifo = fopen(outFifoName.c_str(), "w");
-        if (outFifo == nullptr) {
-            std::cerr << "error opening fifo: " << strerror(errno) << "\n";
-            return;
-        } else {
-            fcntl(fileno(outFifo), F_SETFL, O_NONBLOCK);
-        }
-        squelch = new SnrSquelch<complex<float>>(length, fftSize, hangLength, flushLength, [this, &reportCounter, outFifo] (float snr) {
-            if (--reportCounter <= 0) {
-                fprintf(outFifo, "%g\n", snr);
-                fflush(outFifo);
-                reportCounter = reportInterval;
-            }
-        });
+        auto reporter = openReporter(outFifoName, reportInterval, getErrors());
+        if (reporter == nullptr) return;
+        squelch = new SnrSquelch<complex<float>>(length, fftSize, hangLength, flushLength, [reporter] (float snr) { reporter->report(snr); });
         runModule(squelch);
-        fclose(outFifo);
     });
 }
 
@@ -593,7 +1859,7 @@ BandPassCommand::BandPassCommand(): Command("bandpass", "Bandpass filter") {
         } else if (window == "hamming") {
             windowObj = new HammingWindow();
         } else {
-            std::cerr << "window type \"" << window << "\" not available\n";
+            getErrors() << "window type \"" << window << "\" not available\n";
             return;
         }
         if (use_fft) {
@@ -642,7 +1908,7 @@ TimingRecoveryCommand::TimingRecoveryCommand(): Command("timingrecovery", "Timin
             } else if (format == "complex") {
                 runModule(new GardnerTimingRecovery<complex<float>>(decimation, loop_gain, max_error));
             } else {
-                std::cerr << "Invalid format: \"" << format << "\"\n";
+                getErrors() << "Invalid format: \"" << format << "\"\n";
             }
         } else if (algorithm == "earlylate") {
             if (format == "float") {
@@ -650,10 +1916,10 @@ TimingRecoveryCommand::TimingRecoveryCommand(): Command("timingrecovery", "Timin
             } else if (format == "complex") {
                 runModule(new EarlyLateTimingRecovery<complex<float>>(decimation, loop_gain, max_error));
             } else {
-                std::cerr << "Invalid format: \"" << format << "\"\n";
+                getErrors() << "Invalid format: \"" << format << "\"\n";
             }
         } else {
-            std::cerr << "Invalid algorithm: \"" << algorithm << "\"\n";
+            getErrors() << "Invalid algorithm: \"" << algorithm << "\"\n";
         }
     });
 }
@@ -697,7 +1963,7 @@ LowpassCommand::LowpassCommand(): Command("lowpass", "Lowpass FIR filter") {
         } else if (window == "hamming") {
             w = new HammingWindow();
         } else {
-            std::cerr << "window type \"" << window << "\" not available\n";
+            getErrors() << "window type \"" << window << "\" not available\n";
             return;
         }
         if (format == "float") {
@@ -705,7 +1971,7 @@ LowpassCommand::LowpassCommand(): Command("lowpass", "Lowpass FIR filter") {
         } else if (format == "complex") {
             runModule(new FilterModule<complex<float>>(new LowPassFilter<complex<float>>(cutoffRate, transitionBandwidth, w)));
         } else {
-            std::cerr << "invalid format: " << format << "\n";
+            getErrors() << "invalid format: " << format << "\n";
         }
     });
 }
@@ -21,16 +21,63 @@ along with csdr.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "CLI11.hpp"
 #include "module.hpp"
+#include "ringbuffer.hpp"
 #include "shift.hpp"
 #include "power.hpp"
 #include "fir.hpp"
 #include "snr.hpp"
+#include "threadpolicy.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unistd.h>
+#include <iostream>
 
 namespace Csdr {
 
+    class Chain;
+    class StatisticsReporter;
+    class AsyncRunner;
+    class Executor;
+    class MappedFile;
+    template <typename T>
+    class SharedRingbuffer;
+    template <typename T>
+    class SharedRingbufferReader;
+
     class Command: public CLI::App {
         public:
-            Command(std::string name, std::string description): CLI::App(description, name) {}
+            Command(std::string name, std::string description);
+            // when set, modules are handed to the chain instead of being run directly
+            void setChain(Chain* chain);
+            template <typename T>
+            void readLoop(Ringbuffer<T>* buffer, const std::vector<Command*>& controls, const std::function<void()>& processAll);
+            static void drain(const std::vector<UntypedModule*>& modules);
+            // lets the modules put out what they have held back once the input has ended (see UntypedModule::finish()).
+            // settle has to run the modules until they cannot make any more progress.
+            static void finish(const std::vector<UntypedModule*>& modules, const std::function<void()>& settle);
+            // placement of the thread that processes this command's module
+            ThreadPolicy threadPolicy();
+            // returns nullptr unless statistics have been requested on the command line
+            StatisticsReporter* startStatistics(std::vector<std::pair<std::string, UntypedModule*>> modules);
+            // applies the block size given on the command line, if any
+            void applyBlockSize(UntypedModule* module);
+            // a writer for stdout, buffered as requested on the command line
+            template <typename T>
+            Writer<T>* stdoutWriter();
+            // maps the file given with --input. returns nullptr and reports on stderr if that fails.
+            MappedFile* mapInput();
+            // receives shared memory from the process given with --shm-input. returns nullptr and reports on stderr if that fails.
+            template <typename T>
+            SharedRingbufferReader<T>* sharedInput();
+            // processes the input from another process until it ends
+            template <typename T>
+            void readShared(SharedRingbufferReader<T>* reader, const std::function<void()>& processAll);
         protected:
             template <typename T, typename U>
             void runModule(Module<T, U>* module);
@@ -38,8 +85,175 @@ namespace Csdr {
             void runSource(Source<T>* source);
             virtual void processFifoData(std::string data) {}
             virtual size_t bufferSize() { return 10485760; }
+            RingbufferMemory bufferMemory();
+            // the application holding the global options, even when running within a chain
+            CLI::App* getGlobals();
+            // stdin and stdout, unless the chain has been given other descriptors
+            int getInputFd();
+            int getOutputFd();
+            // where to report errors: stderr, unless the chain reports somewhere else
+            std::ostream& getErrors();
             std::string fifoName = "";
             CLI::Option* addFifoOption();
+            // locks memory and prefaults the buffer if requested on the command line
+            template <typename T>
+            void prepareBuffer(Ringbuffer<T>* buffer);
+            Chain* chain = nullptr;
+        private:
+            // waits for a process to connect to the socket at path and hands it shared memory to read our output from.
+            // returns nullptr and reports on stderr if that fails.
+            template <typename T>
+            SharedRingbuffer<T>* shareOutput(const std::string& path);
+            // limit for a single read from stdin, or 0 to read as much as the buffer can take
+            size_t readBlockSize();
+            std::string cpus;
+            std::string scheduler = "other";
+            int priority = 1;
+            std::string blockSize;
+            unsigned int latency = 10000;
+    };
+
+    // periodically writes the statistics of a set of modules to a file or fifo, one JSON object per line
+    class StatisticsReporter {
+        public:
+            StatisticsReporter(std::string path, unsigned int interval, std::vector<std::pair<std::string, UntypedModule*>> modules);
+            // writes a final report
+            ~StatisticsReporter();
+            // reports on another module for the stage at index from now on
+            void replaceModule(size_t index, std::string name, UntypedModule* module);
+        private:
+            void loop();
+            void report();
+            std::string path;
+            std::chrono::milliseconds interval;
+            std::vector<std::pair<std::string, UntypedModule*>> modules;
+            int fd = -1;
+            bool run = true;
+            std::mutex stateMutex;
+            std::condition_variable stateCondition;
+            // must be the last member, see AsyncRunner
+            std::thread thread;
+    };
+
+    // type-erased stage of a chain, created by Command::runModule()
+    class UntypedChainStage {
+        public:
+            virtual ~UntypedChainStage() = default;
+            virtual UntypedModule* getModule() = 0;
+            virtual Command* getCommand() = 0;
+            virtual UntypedWriter* getInput() = 0;
+            virtual UntypedReader* getReader() = 0;
+            virtual std::string getInputType() = 0;
+            virtual std::string getOutputType() = 0;
+            // returns false if the output type does not match the input type of the next stage
+            virtual bool connect(UntypedChainStage* next) = 0;
+            // read the output of an in-place stage directly from that stage's input buffer
+            virtual bool followInPlace(UntypedWriter* buffer, UntypedReader* upstream) = 0;
+            // returns false and reports on stderr if the output cannot be shared (--shm-output)
+            virtual bool connectStdout() = 0;
+            // in synchronous mode, waits for the consumer if a full output holds the stage back. returns false otherwise.
+            virtual bool waitForOutput() = 0;
+            virtual void prefault() = 0;
+            virtual void readInput(const std::vector<Command*>& controls, const std::function<void()>& processAll) = 0;
+            // read from a mapped file instead of the input buffer
+            virtual void readFile(MappedFile* file) = 0;
+            // read from another process through shared memory (--shm-input). returns false and reports on stderr if that fails.
+            virtual bool readShared() = 0;
+            // see SegmentedModule. returns false if the module does not support it.
+            virtual bool processSegmented(unsigned int threads) = 0;
+            // continues the work of a running stage with the same input and output types, taking over its buffers.
+            // returns false if that is not possible. neither module may be processing meanwhile.
+            virtual bool takeOver(UntypedChainStage* previous) = 0;
+            // true once writing to stdout has failed for good (see UntypedWriter::isClosed())
+            virtual bool isOutputClosed() = 0;
+    };
+
+    // runs multiple modules in one process, connected by ringbuffers instead of pipes
+    class Chain {
+        public:
+            // errors of the chain and its commands are reported on "errors"
+            Chain(std::vector<std::vector<std::string>> descriptions, std::function<void(CLI::App&)> commandFactory, CLI::App* globals, unsigned int threads, ThreadPolicy policy, int inputFd = STDIN_FILENO, int outputFd = STDOUT_FILENO, std::ostream& errors = std::cerr);
+            ~Chain();
+            // splits "command args | command args ..." into stages. reports on errors and returns nothing if that fails.
+            static std::vector<std::vector<std::string>> parse(const std::string& description, std::ostream& errors = std::cerr);
+            CLI::App* getGlobals();
+            int getInputFd();
+            int getOutputFd();
+            std::ostream& getErrors();
+            // true once the output of the last stage has gone away. the input is not read any further then.
+            bool isOutputClosed();
+            void start();
+            void addStage(UntypedChainStage* stage);
+            // a command whose control fifo is read along with those of the stages
+            void setControl(Command* control);
+            // swaps the stage at index (counting from 0) for a new command while the chain is running. the new stage
+            // needs the same input and output types. it continues on the same buffers where the old one left off, so
+            // no samples are lost and the other stages keep running undisturbed.
+            // must be called from the thread that reads the input. reports on stderr and returns false if it fails.
+            bool replace(size_t index, const std::vector<std::string>& description);
+            // true while a command is set up to replace a stage. its stage takes over the buffers of the old one.
+            bool isReplacing();
+        private:
+            void next();
+            void run();
+            void startModule(size_t index);
+            void stopModule(size_t index);
+            std::vector<std::vector<std::string>> descriptions;
+            std::function<void(CLI::App&)> commandFactory;
+            CLI::App* globals;
+            unsigned int threads;
+            // used for stages that do not specify their own policy
+            ThreadPolicy policy;
+            int inputFd;
+            int outputFd;
+            std::ostream& errors;
+            Command* control = nullptr;
+            std::vector<UntypedChainStage*> stages;
+            // set while run() is active, one entry per stage
+            std::vector<UntypedModule*> modules;
+            // the commands whose control fifos are read, one per stage followed by the chain's own
+            std::vector<Command*> controls;
+            StatisticsReporter* stats = nullptr;
+            std::vector<AsyncRunner*> runners;
+            std::vector<Executor*> stageExecutors;
+            std::vector<Executor*> executors;
+            // replacing a stage hands the new one over here instead of setting up the next stage
+            bool replacing = false;
+            UntypedChainStage* replacement = nullptr;
+            // the commands of replacement stages, by stage index. the commands set up by next() live on its stack.
+            std::vector<std::unique_ptr<CLI::App>> replacementApps;
+    };
+
+    class ChainCommand: public Command {
+        public:
+            explicit ChainCommand(std::function<void(CLI::App&)> commandFactory);
+        protected:
+            void processFifoData(std::string data) override;
+        private:
+            unsigned int threads = 0;
+            Chain* running = nullptr;
+    };
+
+    // serves chains to other processes over a Unix socket. setting up a chain in a process that is already running
+    // saves the start-up time and reuses FFT plans and filter designs (see DesignCache).
+    // a client connects, passes its input, output and (optionally) stderr descriptors with SCM_RIGHTS and sends the
+    // chain description, terminated by a newline. errors of the chain are reported on the client's stderr. the chain
+    // ends with its input or once its output has gone away, and the daemon closes the connection then.
+    class DaemonCommand: public Command {
+        public:
+            explicit DaemonCommand(std::function<void(CLI::App&)> commandFactory);
+        private:
+            void serve(int connection, const std::function<void(CLI::App&)>& commandFactory);
+            std::string socketPath;
+            unsigned int threads = 0;
+    };
+
+    // hands its own stdin and stdout to a daemon to run a chain on, and waits for the chain to end
+    class ConnectCommand: public Command {
+        public:
+            ConnectCommand();
+        private:
+            std::string socketPath;
     };
 
     class AgcCommand: public Command {
@@ -139,6 +353,8 @@ namespace Csdr {
             float transitionBandwidth = 0.05;
             float cutoffRate = 0.5;
             std::string window = "hamming";
+            bool multistage = false;
+            bool use_fft = false;
     };
 
     class BenchmarkCommand: public Command {
@@ -160,6 +376,19 @@ namespace Csdr {
             bool prefilter = false;
     };
 
+    class CicDecimateCommand: public Command {
+        public:
+            CicDecimateCommand();
+        protected:
+            size_t bufferSize() override { return 10 * Command::bufferSize(); }
+        private:
+            std::string format = "float";
+            unsigned int ratio = 1;
+            unsigned int order = 4;
+            float passband = 0.25;
+            size_t taps = 31;
+    };
+
     class AdpcmCommand: public Command {
         public:
             AdpcmCommand();
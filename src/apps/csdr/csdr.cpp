@@ -39,7 +39,45 @@ int Cli::main(int argc, char** argv) {
 
     CLI::Option* version_flag = app.add_flag("-v,--version", "Display version information");
     app.add_flag("-a,--async", "run asynchronously");
+    app.add_flag("--hugepages", "back internal buffers with huge pages, if available");
+    app.add_option("--stats", "write runtime statistics of all modules to this file or fifo as JSON lines");
+    app.add_option("--stats-interval", "interval between statistics reports in milliseconds")->default_val("1000");
+    auto input = app.add_option("--input", "read input from this file instead of stdin, as fast as possible")->check(CLI::ExistingFile);
+    app.add_option("--shm-input", "read input from the shared memory of another csdr process, connecting to its --shm-output socket")->excludes(input);
+    app.add_option("--shm-output", "instead of stdout, write output to shared memory that another csdr process reads with --shm-input. waits for it on this Unix socket");
+    app.add_option("--parallel", "with --input, filter independent segments of the file on this many threads. 0 uses all CPUs");
+    app.add_flag("--io-uring", "use io_uring for reading stdin and writing stdout, if available");
+    app.add_flag("--splice", "move input from a stdin pipe into internal buffers with splice()");
+    std::string output = "Output";
+    app.add_flag("--coalesce", "collect small writes to stdout into larger ones")->group(output);
+    app.add_flag("--output-thread", "write to stdout from a separate thread. implies --coalesce")->group(output);
+    app.add_option("--flush-size", "write out once this many bytes are pending")->default_val("65536")->group(output);
+    app.add_option("--flush-interval", "write out pending output after this many milliseconds")->default_val("100")->group(output);
+    app.add_option("--output-overflow", "with --output-thread: wait for the consumer (block), or drop new output when it falls behind (drop)")->default_val("block")->check(CLI::IsMember({"block", "drop"}))->group(output);
+    app.add_flag("--mlock", "lock all memory and prefault internal buffers to avoid page faults during processing");
+
+    addCommands(app);
+    app.add_subcommand(std::shared_ptr<CLI::App>(new ChainCommand([this] (CLI::App& app) { addCommands(app); })));
+    app.add_subcommand(std::shared_ptr<CLI::App>(new DaemonCommand([this] (CLI::App& app) { addCommands(app); })));
+    app.add_subcommand(std::shared_ptr<CLI::App>(new ConnectCommand()));
 
+    app.require_subcommand(1);
+
+    try {
+        app.parse(argc, argv);
+    } catch (const CLI::ParseError &e) {
+        if (*version_flag) {
+            std::cerr << "csdr version " << VERSION << "\n";
+            return 0;
+        }
+
+        return app.exit(e);
+    }
+
+    return 0;
+}
+
+void Cli::addCommands(CLI::App& app) {
     app.add_subcommand(std::shared_ptr<CLI::App>(new AgcCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new FmdemodCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new AmdemodCommand()));
@@ -53,6 +91,7 @@ int Cli::main(int argc, char** argv) {
     app.add_subcommand(std::shared_ptr<CLI::App>(new ShiftCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new FirDecimateCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new FractionalDecimatorCommand()));
+    app.add_subcommand(std::shared_ptr<CLI::App>(new CicDecimateCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new AdpcmCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new FftAdpcmCommand()));
     app.add_subcommand(std::shared_ptr<CLI::App>(new LimitCommand()));
@@ -84,19 +123,4 @@ int Cli::main(int argc, char** argv) {
     app.add_subcommand(std::shared_ptr<CLI::App>(new NavtexDecodeCommand()));
 
     app.add_subcommand(std::shared_ptr<CLI::App>(new BenchmarkCommand()));
-
-    app.require_subcommand(1);
-
-    try {
-        app.parse(argc, argv);
-    } catch (const CLI::ParseError &e) {
-        if (*version_flag) {
-            std::cerr << "csdr version " << VERSION << "\n";
-            return 0;
-        }
-
-        return app.exit(e);
-    }
-
-    return 0;
 }
@@ -20,6 +20,7 @@ along with csdr.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include "module.hpp"
+#include "CLI11.hpp"
 
 namespace Csdr {
 
@@ -27,6 +28,7 @@ namespace Csdr {
         public:
             int main(int argc, char** argv);
         private:
+            void addCommands(CLI::App& app);
             template <typename T, typename U>
             void runModule(Module<T, U>* module);
     };
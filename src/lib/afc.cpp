@@ -19,6 +19,7 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "afc.hpp"
 #include "complex.hpp"
+#include "designcache.hpp"
 #include <string.h>
 #include <stdlib.h>
 
@@ -42,13 +43,12 @@ Afc::Afc(unsigned int updatePeriod, unsigned int samplePeriod): ShiftAddfast(0.0
     unsigned int fftSize = samplePeriod * getLength();
     fftIn   = fftwf_alloc_complex(fftSize);
     fftOut  = fftwf_alloc_complex(fftSize);
-    fftPlan = fftwf_plan_dft_1d(fftSize, fftIn, fftOut, FFTW_FORWARD, CSDR_FFTW_FLAGS);
+    fftPlan = DesignCache::getFftPlan(fftSize, FFTW_FORWARD, CSDR_FFTW_FLAGS);
 }
 
 Afc::~Afc()
 {
-    // Destroy FFT
-    fftwf_destroy_plan(fftPlan);
+    // Free FFT buffers, the plan is shared
     fftwf_free(fftIn);
     fftwf_free(fftOut);
 }
@@ -75,7 +75,7 @@ void Afc::process(complex<float>* input, complex<float>* output)
             updateCount = updatePeriod;
 
             // Calculate FFT on the input buffer
-            fftwf_execute(fftPlan);
+            fftwf_execute_dft(fftPlan, fftIn, fftOut);
 
             unsigned int fftSize = size * samplePeriod;
             float maxMag = mag2(fftOut[0]);
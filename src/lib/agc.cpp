@@ -90,21 +90,11 @@ void Agc<T>::process(T* input, T* output, size_t work_size) {
         if (target_gain < 0) target_gain = 0;
 
         // actual sample scaling
-        if (i < 128)
-        {
-            output[i] = scale(last_samples[i]);
-        }
-        else
-        {
-            output[i] = scale(input[i - 128]);
-        }
-    }
-
-
-
-    for (int i = 0; i < 128; i++)
-    {
-        last_samples[i] = input[(work_size - 128) + i];
+        // the delay line is updated sample by sample so that output may point to the same memory as input
+        T delayed = last_samples[last_samples_pos];
+        last_samples[last_samples_pos] = input[i];
+        last_samples_pos = (last_samples_pos + 1) % 128;
+        output[i] = scale(delayed);
     }
 }
 
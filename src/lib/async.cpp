@@ -22,8 +22,9 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 
 using namespace Csdr;
 
-AsyncRunner::AsyncRunner(UntypedModule* module):
+AsyncRunner::AsyncRunner(UntypedModule* module, ThreadPolicy policy):
     module(module),
+    policy(std::move(policy)),
     thread([this] { loop(); })
 {}
 
@@ -51,6 +52,8 @@ bool AsyncRunner::isRunning() const {
 }
 
 void AsyncRunner::loop() {
+    if (!policy.isDefault()) policy.apply();
+
     // can't use run as a loop condition due to the locking system
     while (true) {
 
@@ -60,13 +63,14 @@ void AsyncRunner::loop() {
         if (!run) return;
 
         try {
-            if (module->canProcess()) {
+            if (!module->isSuspended() && module->canProcess()) {
                 // don't hold the lock during the actual processing since that may cause deadlocks
                 // we should be safe during this period as far as state is concerned
                 lock.unlock();
-                module->process();
+                module->processTimed();
             } else {
-                // lock will be released and re-locked during blocking operation by the wait() method
+                // lock will be released and re-locked during blocking operation by the wait() method.
+                // suspended modules park here until somebody reads their output again.
                 module->wait(lock);
             }
         } catch (const BufferError&) {
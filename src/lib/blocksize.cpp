@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "blocksize.hpp"
+
+#include <algorithm>
+
+using namespace Csdr;
+
+// number of full blocks to measure before judging a block size
+static const unsigned int WINDOW = 32;
+// a larger block size must improve throughput by at least this factor to be kept
+static const double IMPROVEMENT = 1.05;
+
+BlockSizePolicy::BlockSizePolicy(size_t blockSize):
+    minimum(blockSize),
+    maximum(blockSize),
+    latency(0),
+    current(blockSize),
+    previous(blockSize),
+    settled(true)
+{}
+
+BlockSizePolicy::BlockSizePolicy(size_t minimum, size_t maximum, uint64_t latency):
+    minimum(std::max(minimum, (size_t) 1)),
+    maximum(std::max(maximum, this->minimum)),
+    latency(latency),
+    current(this->minimum),
+    previous(this->minimum),
+    settled(this->minimum == this->maximum)
+{}
+
+size_t BlockSizePolicy::getBlockSize() const {
+    return current;
+}
+
+size_t BlockSizePolicy::getMinimum() const {
+    return minimum;
+}
+
+size_t BlockSizePolicy::getMaximum() const {
+    return maximum;
+}
+
+uint64_t BlockSizePolicy::getLatency() const {
+    return latency;
+}
+
+bool BlockSizePolicy::isAdaptive() const {
+    return minimum != maximum;
+}
+
+void BlockSizePolicy::record(size_t samples, uint64_t nanoseconds) {
+    if (!isAdaptive()) return;
+    // partial blocks mean the input is the limiting factor, they tell us nothing about the block size
+    if (samples < current) return;
+    calls++;
+    this->samples += samples;
+    this->nanoseconds += nanoseconds;
+    if (calls >= WINDOW) evaluate();
+}
+
+void BlockSizePolicy::evaluate() {
+    uint64_t average = nanoseconds / calls;
+    double throughput = (double) samples / (double) std::max(nanoseconds, (uint64_t) 1);
+    calls = 0;
+    samples = 0;
+    nanoseconds = 0;
+
+    if (latency > 0 && average > latency * 1000) {
+        // over budget. back off, and don't try to grow again.
+        previous = current;
+        current = std::max(current / 2, minimum);
+        lastThroughput = 0;
+        settled = true;
+        return;
+    }
+
+    if (settled) return;
+
+    if (lastThroughput > 0 && throughput < lastThroughput * IMPROVEMENT) {
+        // the last increase did not pay off
+        current = previous;
+        settled = true;
+        return;
+    }
+
+    lastThroughput = throughput;
+    size_t next = std::min(current * 2, maximum);
+    // processing time grows roughly linearly with the block size
+    if (next == current || (latency > 0 && average * next / current > latency * 1000)) {
+        settled = true;
+        return;
+    }
+    previous = current;
+    current = next;
+}
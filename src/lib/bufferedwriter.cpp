@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "bufferedwriter.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <cerrno>
+#include <unistd.h>
+
+using namespace Csdr;
+
+// space guaranteed to be writeable, same as StdoutWriter
+static const size_t blockSize = 10240;
+
+template <typename T>
+BufferedWriter<T>::BufferedWriter(int fd, size_t flushSize, std::chrono::milliseconds flushInterval, bool threaded, OverflowPolicy overflow, bool ioUring):
+    fd(fd),
+    flushSize(std::max(flushSize, (size_t) 1)),
+    flushInterval(flushInterval),
+    overflow(overflow),
+    // enough room to keep collecting while the I/O thread is busy with a full flush
+    buffer(new Ringbuffer<T>(4 * std::max(this->flushSize, blockSize), RingbufferMemory::ANONYMOUS)),
+    reader(new RingbufferReader<T>(buffer))
+{
+    buffer->setBackpressure(true);
+    if (threaded && ioUring) {
+        try {
+            uring = new IoUring(4);
+            // both are optional optimizations, so failures are not a problem
+            uring->registerFiles({fd});
+            uring->registerBuffer(buffer->getPointer(0), 2 * buffer->getSize() * sizeof(T));
+        } catch (const std::runtime_error& e) {
+            std::cerr << "WARNING: " << e.what() << ", falling back to write()\n";
+        }
+    }
+    if (threaded) {
+        thread = std::thread([this] { loop(); });
+    }
+}
+
+template <typename T>
+BufferedWriter<T>::~BufferedWriter() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            run = false;
+            stateCondition.notify_one();
+        }
+        thread.join();
+    } else {
+        flush();
+    }
+    if (dropped > 0) {
+        std::cerr << "WARNING: output could not keep up, " << dropped << " samples were dropped\n";
+    }
+    delete uring;
+    delete reader;
+    delete buffer;
+}
+
+template <typename T>
+size_t BufferedWriter<T>::writeable() {
+    return blockSize;
+}
+
+template <typename T>
+T* BufferedWriter<T>::getWritePointer() {
+    return buffer->getWritePointer();
+}
+
+template <typename T>
+void BufferedWriter<T>::advance(size_t how_much) {
+    if (overflow == OverflowPolicy::DROP && thread.joinable() && buffer->writeable() < how_much + blockSize) {
+        // the samples have not been committed yet, so they can simply be forgotten
+        dropped.fetch_add(how_much, std::memory_order_relaxed);
+        return;
+    }
+
+    bool wasEmpty = reader->available() == 0;
+    buffer->advance(how_much);
+    write_count.store(write_count.load(std::memory_order_relaxed) + how_much, std::memory_order_relaxed);
+    size_t pending = reader->available();
+
+    if (!thread.joinable()) {
+        auto now = std::chrono::steady_clock::now();
+        if (wasEmpty) oldest = now;
+        if (pending >= flushSize || now - oldest >= flushInterval) writeOut(pending);
+        return;
+    }
+
+    if (wasEmpty || pending >= flushSize) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stateCondition.notify_one();
+    }
+
+    // make sure the next block fits
+    while (buffer->writeable() < blockSize) buffer->wait();
+}
+
+template <typename T>
+uint64_t BufferedWriter<T>::getWriteCount() {
+    return write_count.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void BufferedWriter<T>::flush() {
+    if (!thread.joinable()) {
+        writeOut(reader->available());
+        return;
+    }
+    uint64_t target = buffer->getWriteCount();
+    std::unique_lock<std::mutex> lock(stateMutex);
+    flushRequested = true;
+    stateCondition.notify_one();
+    flushCondition.wait(lock, [this, target] { return reader->getReadCount() >= target; });
+}
+
+template <typename T>
+uint64_t BufferedWriter<T>::getDroppedSamples() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+bool BufferedWriter<T>::isClosed() {
+    return closed.load();
+}
+
+template <typename T>
+void BufferedWriter<T>::loop() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    while (true) {
+        size_t available = reader->available();
+        if (available == 0) {
+            if (!run) break;
+            stateCondition.wait(lock);
+            continue;
+        }
+        // give small writes some time to accumulate
+        if (available < flushSize && run && !flushRequested) {
+            stateCondition.wait_for(lock, flushInterval, [this] {
+                return reader->available() >= flushSize || !run || flushRequested;
+            });
+        }
+        flushRequested = false;
+
+        lock.unlock();
+        writeOut(reader->available());
+        lock.lock();
+        flushCondition.notify_all();
+    }
+}
+
+template <typename T>
+void BufferedWriter<T>::writeOut(size_t how_much) {
+    if (how_much == 0) return;
+    auto data = (const char*) reader->getReadPointer();
+    size_t bytes = how_much * sizeof(T);
+    while (bytes > 0 && !closed.load(std::memory_order_relaxed)) {
+        ssize_t written;
+        if (uring != nullptr) {
+            uint64_t tag;
+            int result = -EIO;
+            if (uring->write(fd, data, bytes, 0) && uring->submit(1)) uring->complete(tag, result);
+            written = result;
+            if (result < 0) {
+                errno = -result;
+                written = -1;
+            }
+        } else {
+            written = ::write(fd, data, bytes);
+        }
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            // the consumer is gone. there is nobody to report to, so the data is discarded from now on.
+            closed.store(true);
+            break;
+        }
+        data += written;
+        bytes -= written;
+    }
+    reader->advance(how_much);
+}
+
+namespace Csdr {
+    template class BufferedWriter<char>;
+    template class BufferedWriter<unsigned char>;
+    template class BufferedWriter<short>;
+    template class BufferedWriter<float>;
+    template class BufferedWriter<complex<float>>;
+}
@@ -0,0 +1,236 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cicdecimator.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
+
+using namespace Csdr;
+
+// the most CIC output produced per process() call. also sizes the buffer in front of the compensation FIR, and the
+// blocks of input that go through the integrators at once.
+static const size_t CIC_BLOCK = 4096;
+// float input may exceed full scale (1.0) by this many bits before it is clipped
+static const unsigned int FLOAT_HEADROOM = 8;
+
+CicCompensationTapGenerator::CicCompensationTapGenerator(unsigned int ratio, unsigned int order, float passband, Window* window):
+    TapGenerator<float>(window),
+    ratio(ratio),
+    order(order),
+    passband(passband)
+{}
+
+float* CicCompensationTapGenerator::generateTaps(size_t length) {
+    // the inverse of the CIC response over the passband, zero above it, transformed back into taps by sampling it
+    // densely. frequencies are relative to the CIC output rate.
+    const size_t points = 1024;
+    int middle = length / 2;
+    auto taps = (float*) malloc(sizeof(float) * length);
+    for (int n = 0; n <= middle; n++) {
+        double acc = 0;
+        for (size_t p = 0; p < points; p++) {
+            double f = (p + 0.5) * passband / points;
+            double response = std::pow(std::fabs(std::sin(M_PI * f) / (ratio * std::sin(M_PI * f / ratio))), order);
+            acc += std::cos(2 * M_PI * f * n) / response;
+        }
+        float window = middle > 0 ? this->window->kernel((float) n / middle) : 1.0f;
+        taps[middle - n] = taps[middle + n] = acc * window;
+    }
+    this->normalize(taps, length);
+    return taps;
+}
+
+std::string CicCompensationTapGenerator::describe() {
+    std::stringstream ss;
+    ss.precision(9);
+    ss << "cic compensation " << ratio << " " << order << " " << passband << " " << typeid(*window).name();
+    return ss.str();
+}
+
+static unsigned int bitGrowth(unsigned int ratio, unsigned int order) {
+    return (unsigned int) std::ceil(order * std::log2((double) ratio));
+}
+
+// the factor that converts input samples to the fixed point values in the integrators. throws if the integrators
+// cannot hold the CIC gain on top of the input.
+template <typename T>
+static float fixedPointScale(unsigned int growth);
+
+template <>
+float fixedPointScale<complex<short>>(unsigned int growth) {
+    // one bit for the sign
+    if (growth + 16 > 63) throw std::runtime_error("CIC ratio and order are too large for 16 bit input");
+    return 1.0f;
+}
+
+template <>
+float fixedPointScale<complex<float>>(unsigned int growth) {
+    // float precision does not go any further
+    const int maxFraction = 32;
+    int fraction = 63 - (int) growth - (int) FLOAT_HEADROOM;
+    if (fraction < 16) throw std::runtime_error("CIC ratio and order are too large for float input");
+    return std::ldexp(1.0f, std::min(fraction, maxFraction));
+}
+
+// the input value that corresponds to 1.0 in the output
+template <typename T>
+static float fullScale();
+
+template <>
+float fullScale<complex<short>>() {
+    // same as the converter
+    return SHRT_MAX;
+}
+
+template <>
+float fullScale<complex<float>>() {
+    return 1.0f;
+}
+
+static inline uint64_t toFixed(short value, float /* scale */) {
+    return (uint64_t) (int64_t) value;
+}
+
+static inline uint64_t toFixed(float value, float scale) {
+    const float limit = 1 << FLOAT_HEADROOM;
+    return (uint64_t) (int64_t) (std::max(-limit, std::min(value, limit)) * scale);
+}
+
+template <typename T>
+CicDecimator<T>::CicDecimator(unsigned int ratio, unsigned int order, float passband, size_t compensationTaps):
+    ratio(ratio),
+    order(order)
+{
+    if (ratio < 1 || order < 1) throw std::runtime_error("CIC ratio and order must be at least 1");
+    inputScale = fixedPointScale<T>(bitGrowth(ratio, order));
+    outputScale = 1.0 / (inputScale * fullScale<T>() * std::pow((double) ratio, (double) order));
+    integrators = (uint64_t*) calloc(order * 2, sizeof(uint64_t));
+    combs = (uint64_t*) calloc(order * 2, sizeof(uint64_t));
+    scratch = (uint64_t*) malloc(sizeof(uint64_t) * CIC_BLOCK * 2);
+
+    if (compensationTaps > 0) {
+        // symmetric around the center
+        compensationTaps = std::max(compensationTaps | 1, (size_t) 3);
+        HammingWindow window;
+        auto generator = new CicCompensationTapGenerator(ratio, order, passband, &window);
+        float* taps = generator->getTaps(compensationTaps);
+        compensation = new FirFilter<complex<float>, float>(taps, compensationTaps);
+        free(taps);
+        delete generator;
+        pendingCapacity = compensation->getOverhead() + CIC_BLOCK;
+        pending = (complex<float>*) malloc(sizeof(complex<float>) * pendingCapacity);
+    }
+}
+
+template <typename T>
+CicDecimator<T>::~CicDecimator() {
+    free(integrators);
+    free(combs);
+    free(scratch);
+    delete compensation;
+    free(pending);
+}
+
+template <typename T>
+size_t CicDecimator<T>::cicSpace() {
+    size_t space = compensation != nullptr ? pendingCapacity - pendingFill : this->writer->writeable();
+    return std::min(space, CIC_BLOCK);
+}
+
+template <typename T>
+size_t CicDecimator<T>::compensationOutput() {
+    size_t overhead = compensation->getOverhead();
+    if (pendingFill <= overhead) return 0;
+    return std::min(pendingFill - overhead, this->writer->writeable());
+}
+
+template <typename T>
+bool CicDecimator<T>::canProcess() {
+    std::lock_guard<std::mutex> lock(this->processMutex);
+    if (this->reader->available() > 0 && cicSpace() > 0) return true;
+    return compensation != nullptr && compensationOutput() > 0;
+}
+
+template <typename T>
+void CicDecimator<T>::process() {
+    std::lock_guard<std::mutex> lock(this->processMutex);
+    size_t space = cicSpace();
+    size_t inputs = space > 0 ? std::min(this->reader->available(), space * ratio - phase) : 0;
+    T* input = this->reader->getReadPointer();
+    complex<float>* output = compensation != nullptr ? pending + pendingFill : this->writer->getWritePointer();
+    size_t produced = 0;
+    for (size_t done = 0; done < inputs; done += CIC_BLOCK) {
+        size_t length = std::min(inputs - done, CIC_BLOCK);
+        auto samples = (typename T::value_type*) (input + done);
+        for (size_t k = 0; k < length * 2; k++) {
+            scratch[k] = toFixed(samples[k], inputScale);
+        }
+        // one stage at a time over the whole block, which keeps the dependency chains short
+        for (unsigned int s = 0; s < order; s++) {
+            uint64_t i = integrators[s * 2];
+            uint64_t q = integrators[s * 2 + 1];
+            for (size_t k = 0; k < length * 2; k += 2) {
+                scratch[k] = i += scratch[k];
+                scratch[k + 1] = q += scratch[k + 1];
+            }
+            integrators[s * 2] = i;
+            integrators[s * 2 + 1] = q;
+        }
+        // the combs only see every ratio-th integrator output
+        for (size_t k = ratio - phase - 1; k < length; k += ratio) {
+            uint64_t i = scratch[k * 2];
+            uint64_t q = scratch[k * 2 + 1];
+            for (unsigned int s = 0; s < order; s++) {
+                uint64_t delayedI = combs[s * 2];
+                uint64_t delayedQ = combs[s * 2 + 1];
+                combs[s * 2] = i;
+                combs[s * 2 + 1] = q;
+                i -= delayedI;
+                q -= delayedQ;
+            }
+            output[produced++] = { (float) (int64_t) i * outputScale, (float) (int64_t) q * outputScale };
+        }
+        phase = (phase + length) % ratio;
+    }
+    this->reader->advance(inputs);
+
+    if (compensation == nullptr) {
+        this->writer->advance(produced);
+        return;
+    }
+
+    pendingFill += produced;
+    size_t count = compensationOutput();
+    if (count == 0) return;
+    compensation->processSamples(pending, 0, 1, this->writer->getWritePointer(), count);
+    pendingFill -= count;
+    std::memmove(pending, pending + count, sizeof(complex<float>) * pendingFill);
+    this->writer->advance(count);
+}
+
+namespace Csdr {
+    template class CicDecimator<complex<float>>;
+    template class CicDecimator<complex<short>>;
+}
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "designcache.hpp"
+#include "complex.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <vector>
+
+using namespace Csdr;
+
+// plans stay alive until the process exits, since any number of modules may be using them
+static std::map<std::tuple<int, int, unsigned int>, fftwf_plan> plans;
+static std::map<std::string, std::vector<char>> taps;
+static std::mutex tapsMutex;
+// different cutoffs for every client would grow the cache forever. taps are cheap to recreate, so just start over.
+static const size_t maxTaps = 256;
+
+std::mutex& DesignCache::plannerMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+fftwf_plan DesignCache::getFftPlan(int size, int sign, unsigned int flags) {
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    auto key = std::make_tuple(size, sign, flags);
+    auto it = plans.find(key);
+    if (it != plans.end()) return it->second;
+
+    // FFTW_MEASURE overwrites the arrays, so plan on scratch memory
+    fftwf_complex* input = fftwf_alloc_complex(size);
+    fftwf_complex* output = fftwf_alloc_complex(size);
+    fftwf_plan plan = fftwf_plan_dft_1d(size, input, output, sign, flags);
+    fftwf_free(input);
+    fftwf_free(output);
+    plans[key] = plan;
+    return plan;
+}
+
+// planning and destroying need the lock, but the transform itself can run concurrently
+static void runOnce(const std::function<fftwf_plan()>& createPlan) {
+    std::unique_lock<std::mutex> lock(DesignCache::plannerMutex());
+    fftwf_plan plan = createPlan();
+    lock.unlock();
+    fftwf_execute(plan);
+    lock.lock();
+    fftwf_destroy_plan(plan);
+}
+
+void DesignCache::executeOnce(int size, fftwf_complex* input, fftwf_complex* output, int sign) {
+    runOnce([size, input, output, sign] {
+        return fftwf_plan_dft_1d(size, input, output, sign, FFTW_ESTIMATE);
+    });
+}
+
+void DesignCache::executeOnce(int size, float* input, fftwf_complex* output) {
+    runOnce([size, input, output] {
+        return fftwf_plan_dft_r2c_1d(size, input, output, FFTW_ESTIMATE);
+    });
+}
+
+template <typename T>
+T* DesignCache::getTaps(const std::string& key, size_t length, const std::function<T*()>& generate) {
+    std::unique_lock<std::mutex> lock(tapsMutex);
+    auto it = taps.find(key);
+    if (it == taps.end() || it->second.size() != sizeof(T) * length) {
+        // generate without holding the lock
+        lock.unlock();
+        T* generated = generate();
+        lock.lock();
+        if (taps.size() >= maxTaps) taps.clear();
+        taps[key] = std::vector<char>((char*) generated, (char*) (generated + length));
+        it = taps.find(key);
+        free(generated);
+    }
+    auto copy = (T*) malloc(sizeof(T) * length);
+    std::memcpy(copy, it->second.data(), sizeof(T) * length);
+    return copy;
+}
+
+namespace Csdr {
+    template float* DesignCache::getTaps(const std::string&, size_t, const std::function<float*()>&);
+    template complex<float>* DesignCache::getTaps(const std::string&, size_t, const std::function<complex<float>*()>&);
+}
@@ -196,7 +196,7 @@ void ExecModule<T, U>::readLoop() {
                 std::cerr << "ExecModule: writer cannot accept data. Stopping readLoop";
                 run = false;
             } else {
-                available = std::min(available, (size_t) 1024) * sizeof(U) - readOffset;
+                available = std::min(available, blockSize.load()) * sizeof(U) - readOffset;
                 read_bytes = read(this->readPipe, ((char*) this->writer->getWritePointer()) + readOffset, available);
                 if (read_bytes <= 0) {
                     if (errno != EAGAIN) {
@@ -248,7 +248,7 @@ void ExecModule<T, U>::process() {
     size_t available = this->reader->available();
     if (available == 0) return;
 
-    size_t size = std::min(available, (size_t) 1024) * sizeof(T) - writeOffset;
+    size_t size = std::min(available, blockSize.load()) * sizeof(T) - writeOffset;
     ssize_t written = write(this->writePipe, ((char*) this->reader->getReadPointer()) + writeOffset, size);
     if (written == -1) {
         // EAGAIN may happen since writePipe is non-blocking.
@@ -260,6 +260,12 @@ void ExecModule<T, U>::process() {
     writeOffset = (writeOffset + written) % sizeof(T);
 }
 
+template <typename T, typename U>
+void ExecModule<T, U>::setBlockSizePolicy(const BlockSizePolicy& policy) {
+    // pipe throughput benefits from large transfers, there is nothing to tune here
+    blockSize = policy.getMaximum();
+}
+
 template <typename T, typename U>
 void ExecModule<T, U>::reload() {
     if (this->child_pid != 0) {
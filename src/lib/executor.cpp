@@ -0,0 +1,252 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "executor.hpp"
+#include "ringbuffer.hpp"
+
+#include <algorithm>
+
+using namespace Csdr;
+
+// maximum number of process() calls before a busy module has to give other modules a chance
+static const unsigned int BATCH_SIZE = 16;
+
+class Executor::Task {
+    public:
+        enum {
+            IDLE,
+            QUEUED,
+            RUNNING,
+            // running, but new data has arrived in the meantime
+            RESCHEDULE,
+            REMOVED
+        };
+        explicit Task(UntypedModule* module): module(module) {}
+        UntypedModule* module;
+        std::atomic<int> state{IDLE};
+        // held while the module is being processed so that removal can wait for completion
+        std::mutex runMutex;
+};
+
+class Executor::Worker {
+    public:
+        std::mutex mutex;
+        // the owner works on the back, thieves take from the front
+        std::deque<std::shared_ptr<Task>> queue;
+        std::thread thread;
+};
+
+// allows tasks that are scheduled from inside a worker to stay on that worker
+static thread_local Executor* currentExecutor = nullptr;
+static thread_local size_t currentWorker = 0;
+
+Executor::Executor(unsigned int threads, ThreadPolicy policy): policy(std::move(policy)) {
+    if (threads == 0) threads = (unsigned int) this->policy.getCpus().size();
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1U);
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.push_back(new Worker());
+    }
+    // all workers must exist before any of them can start stealing
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->thread = std::thread([this, i] { loop(i); });
+    }
+}
+
+Executor::~Executor() {
+    stop();
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    for (auto& entry : tasks) {
+        entry.second->module->setListener(nullptr);
+    }
+    tasks.clear();
+    for (Worker* worker : workers) {
+        delete worker;
+    }
+    workers.clear();
+}
+
+void Executor::addModule(UntypedModule* module) {
+    auto task = std::make_shared<Task>(module);
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        if (tasks.find(module) != tasks.end()) return;
+        tasks[module] = task;
+    }
+    // the weak reference avoids a cycle between the task and the buffers that hold the listener
+    std::weak_ptr<Task> weak = task;
+    module->setListener([this, weak] {
+        auto t = weak.lock();
+        if (t) schedule(t);
+    });
+    // there may be data waiting already
+    schedule(task);
+}
+
+void Executor::removeModule(UntypedModule* module) {
+    std::shared_ptr<Task> task;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        auto it = tasks.find(module);
+        if (it == tasks.end()) return;
+        task = it->second;
+        tasks.erase(it);
+    }
+    module->setListener(nullptr);
+    task->state.store(Task::REMOVED);
+    // wait for a running process() call to finish
+    std::lock_guard<std::mutex> lock(task->runMutex);
+}
+
+void Executor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        if (!run) return;
+        run = false;
+    }
+    sleepCondition.notify_all();
+    for (Worker* worker : workers) {
+        try {
+            worker->thread.join();
+        } catch (std::system_error&) {
+            // NOOP - thread is not joinable
+        }
+    }
+}
+
+bool Executor::isRunning() const {
+    return run;
+}
+
+size_t Executor::getThreadCount() const {
+    return workers.size();
+}
+
+void Executor::schedule(const std::shared_ptr<Task>& task) {
+    int state = task->state.load();
+    while (true) {
+        if (state == Task::IDLE) {
+            if (task->state.compare_exchange_weak(state, Task::QUEUED)) break;
+        } else if (state == Task::RUNNING) {
+            // the worker will pick up the news once it's done
+            if (task->state.compare_exchange_weak(state, Task::RESCHEDULE)) return;
+        } else {
+            // already queued, flagged or removed
+            return;
+        }
+    }
+
+    enqueue(currentExecutor == this ? currentWorker : roundRobin++ % workers.size(), task, false);
+}
+
+void Executor::enqueue(size_t index, const std::shared_ptr<Task>& task, bool front) {
+    Worker* worker = workers[index];
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (front) {
+            worker->queue.push_front(task);
+        } else {
+            worker->queue.push_back(task);
+        }
+    }
+    if (idle.load() > 0) {
+        // taking the lock makes sure the notification can't slip in between a worker's check and its wait
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_one();
+    }
+}
+
+std::shared_ptr<Executor::Task> Executor::next(size_t index) {
+    {
+        Worker* own = workers[index];
+        std::lock_guard<std::mutex> lock(own->mutex);
+        if (!own->queue.empty()) {
+            auto task = own->queue.back();
+            own->queue.pop_back();
+            pending--;
+            return task;
+        }
+    }
+    for (size_t i = 1; i < workers.size(); i++) {
+        Worker* victim = workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->queue.empty()) {
+            auto task = victim->queue.front();
+            victim->queue.pop_front();
+            pending--;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void Executor::loop(size_t index) {
+    currentExecutor = this;
+    currentWorker = index;
+    if (!policy.isDefault()) policy.apply();
+    while (run) {
+        auto task = next(index);
+        if (task) {
+            execute(index, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle++;
+        sleepCondition.wait(lock, [this] { return !run || pending.load() > 0; });
+        idle--;
+    }
+}
+
+void Executor::execute(size_t index, const std::shared_ptr<Task>& task) {
+    std::lock_guard<std::mutex> runLock(task->runMutex);
+    int state = Task::QUEUED;
+    if (!task->state.compare_exchange_strong(state, Task::RUNNING)) return;
+
+    while (true) {
+        unsigned int count = 0;
+        try {
+            // suspended modules are scheduled again once their output gains a reader
+            while (count < BATCH_SIZE && !task->module->isSuspended() && task->module->canProcess()) {
+                task->module->processTimed();
+                count++;
+            }
+        } catch (const BufferError&) {
+            task->state.store(Task::REMOVED);
+            return;
+        }
+
+        if (count == BATCH_SIZE) {
+            // there's more work, but other modules get their turn first
+            state = task->state.load();
+            while (state == Task::RUNNING || state == Task::RESCHEDULE) {
+                if (task->state.compare_exchange_weak(state, Task::QUEUED)) {
+                    enqueue(index, task, true);
+                    return;
+                }
+            }
+            return;
+        }
+
+        state = Task::RUNNING;
+        if (task->state.compare_exchange_strong(state, Task::IDLE)) return;
+        // new data arrived while we were working (unless we have been removed)
+        state = Task::RESCHEDULE;
+        if (!task->state.compare_exchange_strong(state, Task::RUNNING)) return;
+    }
+}
@@ -18,23 +18,24 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "fft.hpp"
+#include "designcache.hpp"
 
 #include <cstring>
 
 using namespace Csdr;
 
 Fft::Fft(unsigned int fftSize, unsigned int everyNSamples, Window* window): fftSize(fftSize), everyNSamples(everyNSamples) {
-    windowed = (complex<float>*) malloc(sizeof(complex<float>) * fftSize);
-    output_buffer = (complex<float>*) malloc(sizeof(complex<float>) * fftSize);
-    plan = fftwf_plan_dft_1d(fftSize, (fftwf_complex*) windowed, (fftwf_complex*) output_buffer, FFTW_FORWARD, FFTW_ESTIMATE);
+    // the shared plan expects FFTW's alignment
+    windowed = (complex<float>*) fftwf_alloc_complex(fftSize);
+    output_buffer = (complex<float>*) fftwf_alloc_complex(fftSize);
+    plan = DesignCache::getFftPlan(fftSize, FFTW_FORWARD, FFTW_ESTIMATE);
     this->window = window->precalculate(fftSize);
 }
 
 Fft::~Fft() {
-    free(windowed);
-    free(output_buffer);
+    fftwf_free(windowed);
+    fftwf_free(output_buffer);
     delete window;
-    fftwf_destroy_plan(plan);
 }
 
 bool Fft::canProcess() {
@@ -62,7 +63,7 @@ void Fft::process() {
             } else {
                 memcpy(windowed, reader->getReadPointer(), fftSize);
             }
-            fftwf_execute(plan);
+            fftwf_execute_dft(plan, (fftwf_complex*) windowed, (fftwf_complex*) output_buffer);
             std::memcpy(writer->getWritePointer(), output_buffer, sizeof(complex<float>) * fftSize);
             writer->advance(fftSize);
 
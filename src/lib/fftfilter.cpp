@@ -31,8 +31,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "fftfilter.hpp"
 #include "fir.hpp"
+#include "designcache.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
 
 using namespace Csdr;
 
@@ -47,10 +52,10 @@ FftFilter<T>::FftFilter(size_t fftSize):
     fftSize(fftSize),
     forwardInput(fftwf_alloc_complex(fftSize)),
     forwardOutput(fftwf_alloc_complex(fftSize)),
-    forwardPlan(fftwf_plan_dft_1d(fftSize, forwardInput, forwardOutput, FFTW_FORWARD, CSDR_FFTW_FLAGS)),
+    forwardPlan(DesignCache::getFftPlan(fftSize, FFTW_FORWARD, CSDR_FFTW_FLAGS)),
     inverseInput(fftwf_alloc_complex(fftSize)),
     inverseOutput(fftwf_alloc_complex(fftSize)),
-    inversePlan(fftwf_plan_dft_1d(fftSize, inverseInput, inverseOutput, FFTW_BACKWARD, CSDR_FFTW_FLAGS)),
+    inversePlan(DesignCache::getFftPlan(fftSize, FFTW_BACKWARD, CSDR_FFTW_FLAGS)),
     overlap((T*) calloc(sizeof(T), fftSize))
 {
     // fill with zeros so that the padding works
@@ -70,10 +75,8 @@ FftFilter<T>::FftFilter(size_t fftSize, complex<float> *taps, size_t taps_length
 template<typename T>
 FftFilter<T>::~FftFilter() {
     free(taps);
-    fftwf_destroy_plan(forwardPlan);
     fftwf_free(forwardInput);
     fftwf_free(forwardOutput);
-    fftwf_destroy_plan(inversePlan);
     fftwf_free(inverseInput);
     fftwf_free(inverseOutput);
     free(overlap);
@@ -87,7 +90,7 @@ size_t FftFilter<T>::apply(T *input, T *output, size_t size) {
     std::memcpy(forwardInput, input, sizeof(T) * inputSize);
 
     // calculate FFT on input buffer
-    fftwf_execute(forwardPlan);
+    fftwf_execute_dft(forwardPlan, forwardInput, forwardOutput);
 
     auto* in = (complex<float>*) forwardOutput;
     auto* out = (complex<float>*) inverseInput;
@@ -98,7 +101,7 @@ size_t FftFilter<T>::apply(T *input, T *output, size_t size) {
     }
 
     // calculate inverse FFT on multiplied buffer
-    fftwf_execute(inversePlan);
+    fftwf_execute_dft(inversePlan, inverseInput, inverseOutput);
 
     // add the overlap of the previous segment
     auto result = (complex<float>*) inverseOutput;
@@ -119,6 +122,13 @@ size_t FftFilter<T>::apply(T *input, T *output, size_t size) {
     return inputSize;
 }
 
+template <typename T>
+Filter<T>* FftFilter<T>::clone() {
+    auto copy = (complex<float>*) malloc(sizeof(complex<float>) * fftSize);
+    std::memcpy(copy, taps, sizeof(complex<float>) * fftSize);
+    return new FftFilter<T>(fftSize, copy, taps_length);
+}
+
 template <typename T>
 size_t FftFilter<T>::filterLength(float transition) {
     size_t result = 4.0 / transition;
@@ -140,11 +150,119 @@ FftBandPassFilter::FftBandPassFilter(float lowcut, float highcut, float transiti
 {
     taps_length = FftBandPassFilter::filterLength(transition);
     auto generator = new BandPassTapGenerator(lowcut, highcut, window);
-    taps = generator->generateFftTaps(taps_length, fftSize);
+    taps = generator->getFftTaps(taps_length, fftSize);
     delete generator;
     inputSize = fftSize - taps_length + 1;
 }
 
+FftDecimator::FftDecimator(unsigned int decimation, float transitionBandwidth, Window* window, float cutoff):
+    decimation(decimation)
+{
+    if (decimation == 0) throw std::runtime_error("decimation must be at least 1");
+    taps_length = 4.0 / transitionBandwidth;
+    if (taps_length % 2 == 0) taps_length++;
+    // at least three quarters of every block is new input
+    outputSize = 16;
+    while (outputSize * decimation < taps_length * 4) outputSize <<= 1;
+    fftSize = outputSize * decimation;
+    hop = (fftSize - taps_length + 1) / decimation * decimation;
+
+    // the taps are delayed by the part of a block that does not fit the hop, so that the first output sample covers
+    // the first taps_length input samples, as in FirDecimate.
+    size_t delay = fftSize - taps_length + 1 - hop;
+    std::stringstream key;
+    key.precision(9);
+    key << "fft decimation " << cutoff / decimation << " " << taps_length << " " << delay << " " << fftSize << " " << typeid(*window).name();
+    size_t length = taps_length;
+    size_t size = fftSize;
+    taps = DesignCache::getTaps<complex<float>>(key.str(), fftSize, [cutoff, decimation, window, length, size, delay] {
+        auto generator = new LowPassTapGenerator(cutoff / decimation, window);
+        float* realTaps = generator->getTaps(length);
+        delete generator;
+        fftwf_complex* input = fftwf_alloc_complex(size);
+        auto output = (complex<float>*) malloc(sizeof(complex<float>) * size);
+        for (size_t i = 0; i < size; i++) {
+            input[i][0] = i >= delay && i < delay + length ? realTaps[i - delay] : 0.0f;
+            input[i][1] = 0.0f;
+        }
+        free(realTaps);
+        DesignCache::executeOnce(size, input, (fftwf_complex*) output, FFTW_FORWARD);
+        fftwf_free(input);
+        // the inverse FFT is not normalized
+        for (size_t i = 0; i < size; i++) output[i] /= size;
+        return output;
+    });
+
+    forwardInput = fftwf_alloc_complex(fftSize);
+    forwardOutput = fftwf_alloc_complex(fftSize);
+    forwardPlan = DesignCache::getFftPlan(fftSize, FFTW_FORWARD, CSDR_FFTW_FLAGS);
+    inverseInput = fftwf_alloc_complex(outputSize);
+    inverseOutput = fftwf_alloc_complex(outputSize);
+    inversePlan = DesignCache::getFftPlan(outputSize, FFTW_BACKWARD, CSDR_FFTW_FLAGS);
+}
+
+FftDecimator::~FftDecimator() {
+    free(taps);
+    fftwf_free(forwardInput);
+    fftwf_free(forwardOutput);
+    fftwf_free(inverseInput);
+    fftwf_free(inverseOutput);
+}
+
+bool FftDecimator::canProcess() {
+    std::lock_guard<std::mutex> lock(processMutex);
+    return reader->available() >= fftSize && writer->writeable() >= hop / decimation;
+}
+
+void FftDecimator::processBlock(size_t available) {
+    size_t length = std::min(available, fftSize);
+    std::memcpy(forwardInput, reader->getReadPointer(), sizeof(complex<float>) * length);
+    std::memset(forwardInput + length, 0, sizeof(fftwf_complex) * (fftSize - length));
+    fftwf_execute_dft(forwardPlan, forwardInput, forwardOutput);
+
+    auto in = (complex<float>*) forwardOutput;
+    auto out = (complex<float>*) inverseInput;
+    // taking every decimation-th sample adds up all the parts of the spectrum that alias onto the output band
+    for (size_t i = 0; i < outputSize; i++) {
+        out[i] = in[i] * taps[i];
+    }
+    for (size_t offset = outputSize; offset < fftSize; offset += outputSize) {
+        for (size_t i = 0; i < outputSize; i++) {
+            out[i] += in[offset + i] * taps[offset + i];
+        }
+    }
+
+    // every sample of the small inverse FFT is every decimation-th sample of the full one
+    fftwf_execute_dft(inversePlan, inverseInput, inverseOutput);
+}
+
+void FftDecimator::process() {
+    std::lock_guard<std::mutex> lock(processMutex);
+    size_t blockOutput = hop / decimation;
+    // the samples before the first valid one are the overlap with the previous block
+    size_t firstOutput = (fftSize - hop) / decimation;
+    while (reader->available() >= fftSize && writer->writeable() >= blockOutput) {
+        processBlock(fftSize);
+        std::memcpy(writer->getWritePointer(), (complex<float>*) inverseOutput + firstOutput, sizeof(complex<float>) * blockOutput);
+        reader->advance(hop);
+        writer->advance(blockOutput);
+    }
+}
+
+bool FftDecimator::finish() {
+    std::lock_guard<std::mutex> lock(processMutex);
+    size_t available = reader->available();
+    // as much output as FirDecimate would produce from the same input
+    if (available < taps_length) return false;
+    size_t count = std::min({(available - taps_length) / decimation, hop / decimation, writer->writeable()});
+    if (count == 0) return false;
+    processBlock(available);
+    std::memcpy(writer->getWritePointer(), (complex<float>*) inverseOutput + (fftSize - hop) / decimation, sizeof(complex<float>) * count);
+    reader->advance(count * decimation);
+    writer->advance(count);
+    return true;
+}
+
 namespace Csdr {
     template class FftFilter<complex<float>>;
 }
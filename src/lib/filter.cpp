@@ -20,6 +20,8 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "filter.hpp"
 #include "complex.hpp"
 
+#include <algorithm>
+
 using namespace Csdr;
 
 template<typename T>
@@ -28,10 +30,15 @@ SparseView<T> SampleFilter<T>::sparse(T* data) {
 }
 
 template <typename T>
-size_t SampleFilter<T>::apply(T *input, T *output, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        output[i] = processSample(input, i);
+void SampleFilter<T>::processSamples(T* data, size_t offset, size_t stride, T* output, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        output[i] = processSample(data, offset + i * stride);
     }
+}
+
+template <typename T>
+size_t SampleFilter<T>::apply(T *input, T *output, size_t size) {
+    processSamples(input, 0, 1, output, size);
     return size;
 }
 
@@ -67,6 +74,62 @@ bool FilterModule<T>::canProcess() {
     return this->reader->available() > filter->getMinProcessingSize() + filter->getOverhead() && this->writer->writeable() > filter->getMinProcessingSize();
 }
 
+template <typename T>
+size_t FilterModule<T>::requiredInput() {
+    return filter->getMinProcessingSize() + filter->getOverhead() + 1;
+}
+
+template <typename T>
+size_t FilterModule<T>::getSegmentAlignment() {
+    // filters with a minimum processing size always work on blocks of that size
+    return std::max(filter->getMinProcessingSize(), (size_t) 1);
+}
+
+template <typename T>
+size_t FilterModule<T>::getSegmentOverhead() {
+    return filter->getMinProcessingSize() + filter->getOverhead();
+}
+
+template <typename T>
+SegmentWorker<T, T>* FilterModule<T>::createSegmentWorker() {
+    auto copy = filter->clone();
+    if (copy == nullptr) return nullptr;
+    return new FilterSegmentWorker<T>(copy);
+}
+
+template <typename T>
+void FilterModule<T>::skipTo(T* position) {
+    size_t history = filter->getHistory();
+    if (history == 0) return;
+    T* scratch = (T*) malloc(sizeof(T) * history);
+    filter->apply(position - history, scratch, history);
+    free(scratch);
+}
+
+template <typename T>
+FilterSegmentWorker<T>::FilterSegmentWorker(Filter<T>* filter):
+    filter(filter),
+    scratch((T*) malloc(sizeof(T) * std::max(filter->getHistory(), (size_t) 1)))
+{}
+
+template <typename T>
+FilterSegmentWorker<T>::~FilterSegmentWorker() {
+    delete filter;
+    free(scratch);
+}
+
+template <typename T>
+size_t FilterSegmentWorker<T>::process(T* input, size_t length, T* output, bool atStart) {
+    size_t history = filter->getHistory();
+    // replay the end of the previous segment to restore the filter state
+    if (!atStart && history > 0) filter->apply(input - history, scratch, history);
+    size_t done = 0;
+    while (done < length) {
+        done += filter->apply(input + done, output + done, length - done);
+    }
+    return length;
+}
+
 template <typename T>
 void FilterModule<T>::process() {
     std::lock_guard<std::mutex> lock(this->processMutex);
@@ -96,4 +159,7 @@ namespace Csdr {
 
     template class FilterModule<complex<float>>;
     template class FilterModule<float>;
+
+    template class FilterSegmentWorker<complex<float>>;
+    template class FilterSegmentWorker<float>;
 }
\ No newline at end of file
@@ -32,10 +32,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "fir.hpp"
 #include "complex.hpp"
 #include "fmv.h"
+#include "designcache.hpp"
+#include "firkernels.h"
 
 #include <cmath>
 #include <cstring>
 #include <fftw3.h>
+#include <sstream>
+#include <typeinfo>
 
 #include <iostream>
 
@@ -50,11 +54,13 @@ template <typename T, typename U>
 FirFilter<T, U>::FirFilter(U* taps, size_t length): FirFilter(length) {
     // better to copy the taps to our memory since that is aligned
     std::memcpy(this->taps, taps, sizeof(U) * length);
+    prepareTaps();
 }
 
 template <typename T, typename U>
 FirFilter<T, U>::~FirFilter() {
     free(taps);
+    free(kernelTaps);
 }
 
 template <typename T, typename U>
@@ -62,6 +68,57 @@ T FirFilter<T, U>::processSample(T *data, size_t index) {
     return processSample_fmv(data, index);
 }
 
+namespace Csdr {
+    template <>
+    float FirFilter<float, float>::processSample(float* data, size_t index) {
+        float result;
+        if (symmetric) {
+            FirKernels::dotSymmetric(data + index, taps, taps_length, 1, &result);
+        } else {
+            FirKernels::dot(data + index, taps, taps_length, 1, &result);
+        }
+        return result;
+    }
+
+    template <>
+    complex<float> FirFilter<complex<float>, float>::processSample(complex<float>* data, size_t index) {
+        float result[2];
+        if (symmetric) {
+            FirKernels::dotSymmetric((float*) (data + index), kernelTaps, taps_length, 2, result);
+        } else {
+            FirKernels::dot((float*) (data + index), kernelTaps, taps_length, 2, result);
+        }
+        return { result[0], result[1] };
+    }
+}
+
+template <typename T, typename U>
+void FirFilter<T, U>::processSamples(T* data, size_t offset, size_t stride, T* output, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        output[i] = processSample_fmv(data, offset + i * stride);
+    }
+}
+
+namespace Csdr {
+    template <>
+    void FirFilter<float, float>::processSamples(float* data, size_t offset, size_t stride, float* output, size_t count) {
+        if (symmetric) {
+            FirKernels::dotSymmetric(data + offset, taps, taps_length, 1, stride, count, output);
+        } else {
+            FirKernels::dot(data + offset, taps, taps_length, 1, stride, count, output);
+        }
+    }
+
+    template <>
+    void FirFilter<complex<float>, float>::processSamples(complex<float>* data, size_t offset, size_t stride, complex<float>* output, size_t count) {
+        if (symmetric) {
+            FirKernels::dotSymmetric((float*) (data + offset), kernelTaps, taps_length, 2, stride, count, (float*) output);
+        } else {
+            FirKernels::dot((float*) (data + offset), kernelTaps, taps_length, 2, stride, count, (float*) output);
+        }
+    }
+}
+
 template <typename T, typename U>
 CSDR_TARGET_CLONES
 T FirFilter<T, U>::processSample_fmv(T *data, size_t index) {
@@ -84,15 +141,76 @@ size_t FirFilter<T, U>::getOverhead() {
     return taps_length;
 }
 
+template <typename T, typename U>
+Filter<T>* FirFilter<T, U>::clone() {
+    // the output only depends on the taps and the current input
+    return new FirFilter<T, U>(taps, taps_length);
+}
+
 template<typename T, typename U>
 void FirFilter<T, U>::allocateTaps(size_t length) {
-    taps = (U*) malloc(length * sizeof(U));
+    // aligned and zero-padded, so the kernels can read whole vectors
+    taps = (U*) FirKernels::allocateTaps(length * sizeof(U) / sizeof(float));
     taps_length = length;
 }
 
+template <typename T, typename U>
+void FirFilter<T, U>::prepareTaps() {
+    // complex taps go through processSample_fmv, which needs nothing else
+}
+
+static bool isSymmetric(float* taps, size_t length) {
+    for (size_t i = 0; i < length / 2; i++) {
+        if (taps[i] != taps[length - 1 - i]) return false;
+    }
+    return true;
+}
+
+namespace Csdr {
+    template <>
+    void FirFilter<float, float>::prepareTaps() {
+        symmetric = isSymmetric(taps, taps_length);
+    }
+
+    template <>
+    void FirFilter<complex<float>, float>::prepareTaps() {
+        symmetric = isSymmetric(taps, taps_length);
+        free(kernelTaps);
+        kernelTaps = FirKernels::allocateTaps(taps_length * 2);
+        for (size_t i = 0; i < taps_length; i++) {
+            kernelTaps[i * 2] = kernelTaps[i * 2 + 1] = taps[i];
+        }
+    }
+}
+
 template<typename T>
 TapGenerator<T>::TapGenerator(Window *window): window(window) {}
 
+template <typename T>
+T* TapGenerator<T>::getTaps(size_t length) {
+    return DesignCache::getTaps<T>(describe() + " " + std::to_string(length), length, [this, length] {
+        return generateTaps(length);
+    });
+}
+
+template <typename T>
+complex<float>* TapGenerator<T>::getFftTaps(size_t length, size_t fftSize) {
+    return DesignCache::getTaps<complex<float>>(describe() + " " + std::to_string(length) + " fft " + std::to_string(fftSize), fftSize, [this, length, fftSize] {
+        return generateFftTaps(length, fftSize);
+    });
+}
+
+// a key for the DesignCache. the window is told apart by its type, since none of them have parameters
+static std::string describeDesign(const std::string& name, std::initializer_list<float> parameters, Window* window) {
+    std::stringstream ss;
+    // enough digits to tell any two floats apart
+    ss.precision(9);
+    ss << name;
+    for (float parameter : parameters) ss << " " << parameter;
+    ss << " " << typeid(*window).name();
+    return ss.str();
+}
+
 template <>
 complex<float>* TapGenerator<complex<float>>::generateFftTaps(size_t length, size_t fftSize) {
     complex<float>* taps = generateTaps(length);
@@ -103,9 +221,7 @@ complex<float>* TapGenerator<complex<float>>::generateFftTaps(size_t length, siz
     taps = (complex<float>*) realloc(taps, sizeof(complex<float>) * fftSize);
     for (size_t i = length; i < fftSize; i++) taps[i] = 0.0f;
     fftwf_complex* output_buffer = fftwf_alloc_complex(fftSize);
-    fftwf_plan plan = fftwf_plan_dft_1d(fftSize, (fftwf_complex*) taps, output_buffer, FFTW_FORWARD, FFTW_ESTIMATE);
-    fftwf_execute(plan);
-    fftwf_destroy_plan(plan);
+    DesignCache::executeOnce(fftSize, (fftwf_complex*) taps, output_buffer, FFTW_FORWARD);
     free(taps);
     return (complex<float>*) output_buffer;
 }
@@ -116,9 +232,7 @@ complex<float>* TapGenerator<float>::generateFftTaps(size_t length, size_t fftSi
     taps = (float*) realloc(taps, sizeof(float) * fftSize);
     for (size_t i = length; i < fftSize; i++) taps[i] = 0.0f;
     fftwf_complex* output_buffer = fftwf_alloc_complex(fftSize);
-    fftwf_plan plan = fftwf_plan_dft_r2c_1d(fftSize, taps, output_buffer, FFTW_ESTIMATE);
-    fftwf_execute(plan);
-    fftwf_destroy_plan(plan);
+    DesignCache::executeOnce(fftSize, taps, output_buffer);
     free(taps);
     return (complex<float>*) output_buffer;
 }
@@ -161,15 +275,20 @@ float* LowPassTapGenerator::generateTaps(size_t length) {
     return taps;
 }
 
+std::string LowPassTapGenerator::describe() {
+    return describeDesign("lowpass", {cutoff}, window);
+}
+
 template <typename T>
 LowPassFilter<T>::LowPassFilter(float cutoff, float transition, Window *window):
     FirFilter<T, float>(LowPassFilter<T>::filterLength(transition))
 {
     auto generator = new LowPassTapGenerator(cutoff, window);
-    float* taps = generator->generateTaps(this->taps_length);
+    float* taps = generator->getTaps(this->taps_length);
     memcpy(this->taps, taps, sizeof(float) * this->taps_length);
     free(taps);
     delete generator;
+    this->prepareTaps();
 }
 
 BandPassTapGenerator::BandPassTapGenerator(float lowcut, float highcut, Window *window):
@@ -204,18 +323,26 @@ complex<float> * BandPassTapGenerator::generateTaps(size_t length) {
     return taps;
 }
 
+std::string BandPassTapGenerator::describe() {
+    return describeDesign("bandpass", {lowcut, highcut}, window);
+}
+
 template<typename T>
 BandPassFilter<T>::BandPassFilter(float lowcut, float highcut, float transition, Window *window):
     FirFilter<T, complex<float>>(BandPassFilter<T>::filterLength(transition))
 {
     auto generator = new BandPassTapGenerator(lowcut, highcut, window);
-    complex<float>* taps = generator->generateTaps(this->taps_length);
+    complex<float>* taps = generator->getTaps(this->taps_length);
     memcpy(this->taps, taps, sizeof(complex<float>) * this->taps_length);
     delete generator;
     free(taps);
+    this->prepareTaps();
 }
 
 namespace Csdr {
+    template class TapGenerator<float>;
+    template class TapGenerator<complex<float>>;
+
     template class FirFilter<complex<float>, complex<float>>;
     template class FirFilter<complex<float>, float>;
     template class FirFilter<float, float>;
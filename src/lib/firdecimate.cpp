@@ -47,14 +47,36 @@ void FirDecimate::process() {
     size_t samples = std::min((available - lpLen) / decimation, writeable);
 
     complex<float>* output = writer->getWritePointer();
-    SparseView<complex<float>> sparseView = lowpass->sparse(reader->getReadPointer());
-    for (size_t i = 0; i < samples; i++) {
-        output[i] = sparseView[i * decimation];
-    }
+    lowpass->processSamples(reader->getReadPointer(), 0, decimation, output, samples);
     reader->advance(samples * decimation);
     writer->advance(samples);
 }
 
+size_t FirDecimate::requiredInput() {
+    // enough for at least one output sample
+    return lowpass->getOverhead() + decimation;
+}
+
+size_t FirDecimate::getSegmentOverhead() {
+    return lowpass->getOverhead();
+}
+
+SegmentWorker<complex<float>, complex<float>>* FirDecimate::createSegmentWorker() {
+    return new FirDecimateSegmentWorker(decimation, lowpass);
+}
+
+FirDecimateSegmentWorker::FirDecimateSegmentWorker(unsigned int decimation, LowPassFilter<complex<float>>* lowpass):
+    decimation(decimation),
+    lowpass(lowpass)
+{}
+
+size_t FirDecimateSegmentWorker::process(complex<float>* input, size_t length, complex<float>* output, bool /* atStart */) {
+    // every output sample only depends on the input under the filter at that point
+    size_t samples = length / decimation;
+    lowpass->processSamples(input, 0, decimation, output, samples);
+    return samples;
+}
+
 bool FirDecimate::canProcess() {
     std::lock_guard<std::mutex> lock(processMutex);
     size_t available = reader->available();
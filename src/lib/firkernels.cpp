@@ -0,0 +1,311 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "firkernels.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CSDR_FIR_X86
+#include <immintrin.h>
+#endif
+
+using namespace Csdr;
+
+// computes count results, with the samples advancing by stride (in samples) between them
+typedef void (*KernelFunction)(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result);
+
+// plain C++ for everything else. the compiler may still vectorize these.
+template <size_t C>
+static inline void dotGenericOne(const float* data, const float* taps, size_t length, float* result) {
+    float acc[C] = {};
+    for (size_t i = 0; i < length * C; i += C) {
+        for (size_t c = 0; c < C; c++) acc[c] += data[i + c] * taps[i + c];
+    }
+    for (size_t c = 0; c < C; c++) result[c] = acc[c];
+}
+
+template <size_t C>
+static inline void dotSymmetricGenericOne(const float* data, const float* taps, size_t length, float* result) {
+    float acc[C] = {};
+    size_t half = length / 2;
+    for (size_t k = 0; k < half; k++) {
+        for (size_t c = 0; c < C; c++) acc[c] += (data[k * C + c] + data[(length - 1 - k) * C + c]) * taps[k * C + c];
+    }
+    if (length % 2) {
+        for (size_t c = 0; c < C; c++) acc[c] += data[half * C + c] * taps[half * C + c];
+    }
+    for (size_t c = 0; c < C; c++) result[c] = acc[c];
+}
+
+template <size_t C>
+static void dotGeneric(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result) {
+    for (size_t i = 0; i < count; i++) dotGenericOne<C>(data + i * stride * C, taps, length, result + i * C);
+}
+
+template <size_t C>
+static void dotSymmetricGeneric(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result) {
+    for (size_t i = 0; i < count; i++) dotSymmetricGenericOne<C>(data + i * stride * C, taps, length, result + i * C);
+}
+
+#ifdef CSDR_FIR_X86
+
+// the symmetric kernels finish with one vector of fewer than "samples" pairs starting at sample k, plus the center
+// sample of odd lengths. front receives the samples from k on, back the mirrored ones in reverse order, so that
+// reversing back lines them up with their partners. the rest of both stays zero, as do the products with the taps.
+template <size_t C>
+static inline void symmetricTail(const float* data, size_t length, size_t k, size_t samples, float* front, float* back) {
+    size_t half = length / 2;
+    size_t rest = half - k;
+    std::memcpy(front, data + k * C, rest * C * sizeof(float));
+    if (length % 2) std::memcpy(front + rest * C, data + half * C, C * sizeof(float));
+    std::memcpy(back + (samples - rest) * C, data + (length - k - rest) * C, rest * C * sizeof(float));
+}
+
+// SSE2 is part of x86_64, so this needs no runtime check
+
+// loads fewer than 4 floats, without reading past them
+static inline __m128 loadPartialSse(const float* data, size_t floats) {
+    float partial[4] = {};
+    std::memcpy(partial, data, floats * sizeof(float));
+    return _mm_loadu_ps(partial);
+}
+
+// reverses the order of the samples in a vector, keeping the channels of each sample together
+template <size_t C>
+static inline __m128 reverseSse(__m128 v);
+
+template <>
+inline __m128 reverseSse<1>(__m128 v) {
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+template <>
+inline __m128 reverseSse<2>(__m128 v) {
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+template <size_t C>
+static inline void reduceSse(__m128 acc, float* result) {
+    // for two channels, the lanes are (i, q, i, q)
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    if (C == 1) acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    for (size_t c = 0; c < C; c++) result[c] = lanes[c];
+}
+
+template <size_t C>
+static inline void dotSseOne(const float* data, const float* taps, size_t length, float* result) {
+    size_t floats = length * C;
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= floats; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(data + i), _mm_load_ps(taps + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(data + i + 4), _mm_load_ps(taps + i + 4)));
+    }
+    if (i + 4 <= floats) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(data + i), _mm_load_ps(taps + i)));
+        i += 4;
+    }
+    if (i < floats) {
+        // SSE has no masked loads. the taps are padded with zeroes, the samples are copied to a zeroed vector.
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(loadPartialSse(data + i, floats - i), _mm_load_ps(taps + i)));
+    }
+    reduceSse<C>(_mm_add_ps(acc0, acc1), result);
+}
+
+template <size_t C>
+static inline void dotSymmetricSseOne(const float* data, const float* taps, size_t length, float* result) {
+    const size_t samples = 4 / C;
+    size_t half = length / 2;
+    __m128 acc = _mm_setzero_ps();
+    size_t k = 0;
+    for (; k + samples <= half; k += samples) {
+        __m128 front = _mm_loadu_ps(data + k * C);
+        __m128 back = reverseSse<C>(_mm_loadu_ps(data + (length - k - samples) * C));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_add_ps(front, back), _mm_load_ps(taps + k * C)));
+    }
+    if (k < half || length % 2) {
+        float front[4] = {};
+        float back[4] = {};
+        symmetricTail<C>(data, length, k, samples, front, back);
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(front), reverseSse<C>(_mm_loadu_ps(back)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(sum, _mm_load_ps(taps + k * C)));
+    }
+    reduceSse<C>(acc, result);
+}
+
+template <size_t C>
+static void dotSse(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result) {
+    for (size_t i = 0; i < count; i++) dotSseOne<C>(data + i * stride * C, taps, length, result + i * C);
+}
+
+template <size_t C>
+static void dotSymmetricSse(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result) {
+    for (size_t i = 0; i < count; i++) dotSymmetricSseOne<C>(data + i * stride * C, taps, length, result + i * C);
+}
+
+// AVX2 and FMA, for CPUs that have them
+
+template <size_t C>
+__attribute__((target("avx2,fma")))
+static inline __m256 reverseAvx2(__m256 v);
+
+template <>
+__attribute__((target("avx2,fma")))
+inline __m256 reverseAvx2<1>(__m256 v) {
+    return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+template <>
+__attribute__((target("avx2,fma")))
+inline __m256 reverseAvx2<2>(__m256 v) {
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+template <size_t C>
+__attribute__((target("avx2,fma")))
+static inline void reduceAvx2(__m256 acc, float* result) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    if (C == 1) sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    for (size_t c = 0; c < C; c++) result[c] = lanes[c];
+}
+
+template <size_t C>
+__attribute__((target("avx2,fma")))
+static inline void dotAvx2One(const float* data, const float* taps, size_t length, float* result) {
+    size_t floats = length * C;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= floats; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(data + i), _mm256_load_ps(taps + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(data + i + 8), _mm256_load_ps(taps + i + 8), acc1);
+    }
+    if (i + 8 <= floats) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(data + i), _mm256_load_ps(taps + i), acc0);
+        i += 8;
+    }
+    if (i < floats) {
+        // the taps are padded with zeroes, but the samples must not be read past their end
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (floats - i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        acc1 = _mm256_fmadd_ps(_mm256_maskload_ps(data + i, mask), _mm256_load_ps(taps + i), acc1);
+    }
+    reduceAvx2<C>(_mm256_add_ps(acc0, acc1), result);
+}
+
+template <size_t C>
+__attribute__((target("avx2,fma")))
+static inline void dotSymmetricAvx2One(const float* data, const float* taps, size_t length, float* result) {
+    const size_t samples = 8 / C;
+    size_t half = length / 2;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t k = 0;
+    for (; k + 2 * samples <= half; k += 2 * samples) {
+        __m256 front0 = _mm256_loadu_ps(data + k * C);
+        __m256 back0 = reverseAvx2<C>(_mm256_loadu_ps(data + (length - k - samples) * C));
+        acc0 = _mm256_fmadd_ps(_mm256_add_ps(front0, back0), _mm256_load_ps(taps + k * C), acc0);
+        __m256 front1 = _mm256_loadu_ps(data + (k + samples) * C);
+        __m256 back1 = reverseAvx2<C>(_mm256_loadu_ps(data + (length - k - 2 * samples) * C));
+        acc1 = _mm256_fmadd_ps(_mm256_add_ps(front1, back1), _mm256_load_ps(taps + (k + samples) * C), acc1);
+    }
+    if (k + samples <= half) {
+        __m256 front = _mm256_loadu_ps(data + k * C);
+        __m256 back = reverseAvx2<C>(_mm256_loadu_ps(data + (length - k - samples) * C));
+        acc0 = _mm256_fmadd_ps(_mm256_add_ps(front, back), _mm256_load_ps(taps + k * C), acc0);
+        k += samples;
+    }
+    if (k < half || length % 2) {
+        float front[8] = {};
+        float back[8] = {};
+        symmetricTail<C>(data, length, k, samples, front, back);
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(front), reverseAvx2<C>(_mm256_loadu_ps(back)));
+        acc1 = _mm256_fmadd_ps(sum, _mm256_load_ps(taps + k * C), acc1);
+    }
+    reduceAvx2<C>(_mm256_add_ps(acc0, acc1), result);
+}
+
+template <size_t C>
+__attribute__((target("avx2,fma")))
+static void dotAvx2(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result) {
+    for (size_t i = 0; i < count; i++) dotAvx2One<C>(data + i * stride * C, taps, length, result + i * C);
+}
+
+template <size_t C>
+__attribute__((target("avx2,fma")))
+static void dotSymmetricAvx2(const float* data, const float* taps, size_t length, size_t stride, size_t count, float* result) {
+    for (size_t i = 0; i < count; i++) dotSymmetricAvx2One<C>(data + i * stride * C, taps, length, result + i * C);
+}
+
+#endif
+
+namespace {
+    // indexed by the number of channels - 1
+    struct Implementation {
+        KernelFunction dot[2];
+        KernelFunction dotSymmetric[2];
+    };
+}
+
+static const Implementation& implementation() {
+    static const Implementation selected = [] () -> Implementation {
+#ifdef CSDR_FIR_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return {{dotAvx2<1>, dotAvx2<2>}, {dotSymmetricAvx2<1>, dotSymmetricAvx2<2>}};
+        }
+        return {{dotSse<1>, dotSse<2>}, {dotSymmetricSse<1>, dotSymmetricSse<2>}};
+#else
+        return {{dotGeneric<1>, dotGeneric<2>}, {dotSymmetricGeneric<1>, dotSymmetricGeneric<2>}};
+#endif
+    }();
+    return selected;
+}
+
+float* FirKernels::allocateTaps(size_t floats) {
+    size_t padded = (floats + TAP_PADDING_FLOATS - 1) / TAP_PADDING_FLOATS * TAP_PADDING_FLOATS;
+    if (padded == 0) padded = TAP_PADDING_FLOATS;
+    void* taps = nullptr;
+    if (posix_memalign(&taps, TAP_PADDING_FLOATS * sizeof(float), padded * sizeof(float)) != 0) return nullptr;
+    std::memset(taps, 0, padded * sizeof(float));
+    return (float*) taps;
+}
+
+void FirKernels::dot(const float* data, const float* taps, size_t length, size_t channels, float* result) {
+    implementation().dot[channels - 1](data, taps, length, 0, 1, result);
+}
+
+void FirKernels::dotSymmetric(const float* data, const float* taps, size_t length, size_t channels, float* result) {
+    implementation().dotSymmetric[channels - 1](data, taps, length, 0, 1, result);
+}
+
+void FirKernels::dot(const float* data, const float* taps, size_t length, size_t channels, size_t stride, size_t count, float* result) {
+    implementation().dot[channels - 1](data, taps, length, stride, count, result);
+}
+
+void FirKernels::dotSymmetric(const float* data, const float* taps, size_t length, size_t channels, size_t stride, size_t count, float* result) {
+    implementation().dotSymmetric[channels - 1](data, taps, length, stride, count, result);
+}
@@ -0,0 +1,45 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+namespace Csdr {
+
+    // dot products of real FIR taps and samples, vectorized for the CPU we are running on (selected at runtime).
+    // the samples are interleaved in channels: 1 for float input, 2 for complex input. the taps are repeated once
+    // per channel, so complex input is filtered like float input. result receives one sum per channel.
+    // taps must come from allocateTaps(), since the kernels rely on their alignment and zero padding.
+    namespace FirKernels {
+        // 16 floats (64 bytes), both the alignment and the granularity of the padding
+        static const size_t TAP_PADDING_FLOATS = 16;
+
+        // zeroed, 64-byte aligned memory for this many floats, padded to a multiple of TAP_PADDING_FLOATS. release with free().
+        float* allocateTaps(size_t floats);
+        void dot(const float* data, const float* taps, size_t length, size_t channels, float* result);
+        // for taps that are symmetric around their center. every pair of mirrored samples is added up before it is
+        // multiplied, which halves the multiplications. only the first (length + 1) / 2 taps are read.
+        void dotSymmetric(const float* data, const float* taps, size_t length, size_t channels, float* result);
+        // the same for count results, where each one starts stride samples after the previous one
+        void dot(const float* data, const float* taps, size_t length, size_t channels, size_t stride, size_t count, float* result);
+        void dotSymmetric(const float* data, const float* taps, size_t length, size_t channels, size_t stride, size_t count, float* result);
+    }
+
+}
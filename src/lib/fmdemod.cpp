@@ -35,6 +35,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 using namespace Csdr;
 
+FmDemod::FmDemod() {
+    setBlockSizePolicy(BlockSizePolicy(1024));
+}
+
 void FmDemod::process(complex<float>* input, float* output, size_t work_size) {
     float phase, dphase;
     for (size_t i = 0; i < work_size; i++) {
@@ -40,6 +40,7 @@ FractionalDecimator<T>::FractionalDecimator(float rate, unsigned int num_poly_po
     xifirst(-(this->num_poly_points / 2) + 1),
     xilast(this->num_poly_points / 2),
     coeffs_buf((float*) malloc(this->num_poly_points * sizeof(float))),
+    filtered((T*) malloc(this->num_poly_points * sizeof(T))),
     rate(rate),
     filter(filter)
 {
@@ -60,6 +61,7 @@ template <typename T>
 FractionalDecimator<T>::~FractionalDecimator() {
     free(poly_precalc_denomiator);
     free(coeffs_buf);
+    free(filtered);
 }
 
 template <typename T>
@@ -97,9 +99,9 @@ void FractionalDecimator<T>::process() {
         }
         T acc = 0;
         if (filter != nullptr) {
+            filter->processSamples(input, index, 1, filtered, num_poly_points);
             for (int i = 0; i < num_poly_points; i++) {
-                SparseView<T> sparse = filter->sparse(input);
-                acc += (coeffs_buf[i] / poly_precalc_denomiator[i]) * sparse[index + i];
+                acc += (coeffs_buf[i] / poly_precalc_denomiator[i]) * filtered[i];
             }
         } else {
             for (int i = 0; i < num_poly_points; i++) {
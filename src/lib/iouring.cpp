@@ -0,0 +1,239 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "iouring.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#ifdef CSDR_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+using namespace Csdr;
+
+#ifdef CSDR_IO_URING
+
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+IoUring::IoUring(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd = io_uring_setup(entries, &params);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("io_uring_setup() failed: ") + strerror(errno));
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+    } else if (single) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) cqRing = nullptr;
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) sqes = nullptr;
+
+    if (sqRing == nullptr || cqRing == nullptr || sqes == nullptr) {
+        std::string error = strerror(errno);
+        release();
+        throw std::runtime_error("unable to map io_uring: " + error);
+    }
+
+    auto sq = (char*) sqRing;
+    sqHead = (unsigned*) (sq + params.sq_off.head);
+    sqTail = (unsigned*) (sq + params.sq_off.tail);
+    sqMask = (unsigned*) (sq + params.sq_off.ring_mask);
+    sqArray = (unsigned*) (sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    sqQueued = sqSubmitted = *sqTail;
+
+    auto cq = (char*) cqRing;
+    cqHead = (unsigned*) (cq + params.cq_off.head);
+    cqTail = (unsigned*) (cq + params.cq_off.tail);
+    cqMask = (unsigned*) (cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+}
+
+IoUring::~IoUring() {
+    release();
+}
+
+void IoUring::release() {
+    if (sqes != nullptr) munmap(sqes, sqesSize);
+    if (cqRing != nullptr && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing != nullptr) munmap(sqRing, sqRingSize);
+    if (fd >= 0) close(fd);
+    sqes = cqRing = sqRing = nullptr;
+    fd = -1;
+}
+
+bool IoUring::isAvailable() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = io_uring_setup(1, &params);
+    if (fd < 0) return false;
+    close(fd);
+    return true;
+}
+
+bool IoUring::registerFiles(const std::vector<int>& fds) {
+    if (!files.empty() || fds.empty()) return false;
+    if (io_uring_register(fd, IORING_REGISTER_FILES, fds.data(), (unsigned) fds.size()) < 0) return false;
+    files = fds;
+    return true;
+}
+
+bool IoUring::registerBuffer(void* data, size_t size) {
+    if (buffer != nullptr) return false;
+    struct iovec iov = { .iov_base = data, .iov_len = size };
+    if (io_uring_register(fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) return false;
+    buffer = (char*) data;
+    bufferSize = size;
+    return true;
+}
+
+void* IoUring::prepare(uint8_t opcode, int fd, uint64_t address, uint32_t length, uint64_t userData, bool link) {
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqQueued - head >= sqEntries) return nullptr;
+
+    unsigned index = sqQueued & *sqMask;
+    auto sqe = (io_uring_sqe*) sqes + index;
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    auto file = std::find(files.begin(), files.end(), fd);
+    if (fd >= 0 && file != files.end()) {
+        sqe->fd = (int) (file - files.begin());
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    if (link) sqe->flags |= IOSQE_IO_LINK;
+    sqe->addr = address;
+    sqe->len = length;
+    sqe->user_data = userData;
+    sqArray[index] = index;
+    sqQueued++;
+    return sqe;
+}
+
+bool IoUring::read(int fd, void* data, size_t length, uint64_t userData, bool link) {
+    auto start = (char*) data;
+    bool fixed = buffer != nullptr && start >= buffer && start + length <= buffer + bufferSize;
+    auto sqe = (io_uring_sqe*) prepare(fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, fd, (uint64_t) data, (uint32_t) length, userData, link);
+    if (sqe == nullptr) return false;
+    // -1: use (and advance) the file position, which is what pipes need
+    sqe->off = (uint64_t) -1;
+    sqe->buf_index = 0;
+    return true;
+}
+
+bool IoUring::write(int fd, const void* data, size_t length, uint64_t userData, bool link) {
+    auto start = (const char*) data;
+    bool fixed = buffer != nullptr && start >= buffer && start + length <= buffer + bufferSize;
+    auto sqe = (io_uring_sqe*) prepare(fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE, fd, (uint64_t) data, (uint32_t) length, userData, link);
+    if (sqe == nullptr) return false;
+    sqe->off = (uint64_t) -1;
+    sqe->buf_index = 0;
+    return true;
+}
+
+bool IoUring::poll(int fd, short events, uint64_t userData, bool link) {
+    auto sqe = (io_uring_sqe*) prepare(IORING_OP_POLL_ADD, fd, 0, 0, userData, link);
+    if (sqe == nullptr) return false;
+    sqe->poll_events = (uint16_t) events;
+    return true;
+}
+
+bool IoUring::cancel(uint64_t target, uint64_t userData) {
+    return prepare(IORING_OP_ASYNC_CANCEL, -1, target, 0, userData, false) != nullptr;
+}
+
+bool IoUring::submit(unsigned minComplete) {
+    __atomic_store_n(sqTail, sqQueued, __ATOMIC_RELEASE);
+    while (true) {
+        unsigned toSubmit = sqQueued - sqSubmitted;
+        // nothing to do, and the completions are there already
+        if (toSubmit == 0 && (minComplete == 0 || __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) - *cqHead >= minComplete)) {
+            return true;
+        }
+        int rc = io_uring_enter(fd, toSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sqSubmitted += rc;
+        if (sqSubmitted == sqQueued) return true;
+    }
+}
+
+bool IoUring::complete(uint64_t& userData, int& result) {
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return false;
+    auto cqe = (io_uring_cqe*) cqes + (head & *cqMask);
+    userData = cqe->user_data;
+    result = cqe->res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else
+
+IoUring::IoUring(unsigned entries) {
+    throw std::runtime_error("csdr was built without io_uring support");
+}
+
+IoUring::~IoUring() = default;
+
+void IoUring::release() {}
+
+bool IoUring::isAvailable() { return false; }
+bool IoUring::registerFiles(const std::vector<int>& fds) { return false; }
+bool IoUring::registerBuffer(void* data, size_t size) { return false; }
+bool IoUring::read(int fd, void* data, size_t length, uint64_t userData, bool link) { return false; }
+bool IoUring::write(int fd, const void* data, size_t length, uint64_t userData, bool link) { return false; }
+bool IoUring::poll(int fd, short events, uint64_t userData, bool link) { return false; }
+bool IoUring::cancel(uint64_t target, uint64_t userData) { return false; }
+bool IoUring::submit(unsigned minComplete) { return false; }
+bool IoUring::complete(uint64_t& userData, int& result) { return false; }
+
+#endif
@@ -0,0 +1,69 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mappedfile.hpp"
+
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace Csdr;
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("unable to open " + path + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        std::string error = strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("unable to stat " + path + ": " + error);
+    }
+    size = (size_t) st.st_size;
+    if (size > 0) {
+        data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            std::string error = strerror(errno);
+            data = nullptr;
+            ::close(fd);
+            throw std::runtime_error("unable to map " + path + ": " + error);
+        }
+        // the file is read front to back exactly once, so aggressive readahead pays off
+        ::madvise(data, size, MADV_SEQUENTIAL);
+    }
+    // the mapping keeps the file alive
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) ::munmap(data, size);
+}
+
+void* MappedFile::getData() {
+    return data;
+}
+
+size_t MappedFile::getSize() {
+    return size;
+}
@@ -18,11 +18,53 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "module.hpp"
+#include "ringbuffer.hpp"
 
 #include <algorithm>
+#include <chrono>
 
 using namespace Csdr;
 
+static uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void UntypedModule::processTimed() {
+    recordInputFill(getInputFill());
+    auto start = std::chrono::steady_clock::now();
+    process();
+    uint64_t nanoseconds = nanosecondsSince(start);
+
+    processCalls.fetch_add(1, std::memory_order_relaxed);
+    processNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    size_t bucket = 0;
+    for (uint64_t us = nanoseconds / 1000; us > 0 && bucket < ModuleStatistics::HISTOGRAM_BUCKETS - 1; us >>= 1) bucket++;
+    processHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+ModuleStatistics UntypedModule::getStatistics() {
+    ModuleStatistics stats;
+    stats.processCalls = processCalls.load(std::memory_order_relaxed);
+    stats.processNanoseconds = processNanoseconds.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < ModuleStatistics::HISTOGRAM_BUCKETS; i++) {
+        stats.processHistogram[i] = processHistogram[i].load(std::memory_order_relaxed);
+    }
+    stats.waitNanoseconds = waitNanoseconds.load(std::memory_order_relaxed);
+    stats.inputFillHighWater = inputFillHighWater.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void UntypedModule::recordWait(uint64_t nanoseconds) {
+    waitNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void UntypedModule::recordInputFill(size_t fill) {
+    // only the thread processing the module records, so there is no need for a compare-and-swap
+    if (fill > inputFillHighWater.load(std::memory_order_relaxed)) {
+        inputFillHighWater.store(fill, std::memory_order_relaxed);
+    }
+}
+
 template <typename T, typename U>
 Module<T, U>::~Module() {
     std::lock_guard<std::mutex> lock(processMutex);
@@ -30,11 +72,34 @@ Module<T, U>::~Module() {
 
 template <typename T, typename U>
 void Module<T, U>::wait(std::unique_lock<std::mutex>& lock) {
+    // if the output cannot take what the input has to offer, progress depends on our consumers, not on new input.
+    // the same goes for a suspended module, which waits for a reader to show up.
+    auto w = this->getWriter();
+    if (suspended || (w->hasBackpressure() && w->writeable() < this->getReader()->available())) {
+        waitingWriter = w;
+
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        waitingWriter->wait();
+        this->recordWait(nanosecondsSince(start));
+        lock.lock();
+
+        waitingWriter = nullptr;
+        return;
+    }
+
     waitingReader = this->getReader();
+    {
+        // the requirement may have changed since the last time we were here
+        std::lock_guard<std::mutex> processLock(processMutex);
+        waitingReader->setWakeThreshold(requiredInput());
+    }
 
     // we are in a consistent state, so we can unlock during the blocking op
     lock.unlock();
+    auto start = std::chrono::steady_clock::now();
     waitingReader->wait();
+    this->recordWait(nanosecondsSince(start));
     lock.lock();
 
     waitingReader = nullptr;
@@ -46,19 +111,124 @@ void Module<T, U>::unblock() {
     if (r != nullptr) {
         r->unblock();
     }
+    auto w = waitingWriter;
+    if (w != nullptr) {
+        w->unblock();
+    }
 }
 
 template <typename T, typename U>
 void Module<T, U>::setWriter(Writer<U> *writer) {
-    std::lock_guard<std::mutex> lock(processMutex);
-    Source<U>::setWriter(writer);
+    std::function<void()> l;
+    {
+        std::lock_guard<std::mutex> lock(processMutex);
+        auto oldWriter = this->writer;
+        if (oldWriter == writer) return;
+        Source<U>::setWriter(writer);
+        if (oldWriter != nullptr) {
+            if (listener) oldWriter->setListener(nullptr);
+            // we may still be wait()ing for space on the old writer
+            oldWriter->unblock();
+        }
+        if (writer != waitingWriter) waitingWriter = nullptr;
+        if (writer != nullptr && listener) writer->setListener(listener);
+        l = listener;
+    }
+    // the new writer may have space for data that was previously held back
+    if (l) l();
 }
 
 template <typename T, typename U>
 void Module<T, U>::setReader(Reader<T> *reader) {
+    std::function<void()> l;
+    {
+        std::lock_guard<std::mutex> lock(processMutex);
+        auto oldReader = this->reader;
+        if (oldReader == reader) return;
+        if (oldReader != nullptr && listener) oldReader->setListener(nullptr);
+        Sink<T>::setReader(reader);
+        if (reader != waitingReader) waitingReader = nullptr;
+        if (reader != nullptr) {
+            // the reader may come from a module that was in a different state
+            if (suspended) {
+                reader->suspend();
+            } else {
+                reader->resume();
+            }
+            reader->setWakeThreshold(requiredInput());
+            if (listener) reader->setListener(listener);
+        }
+        l = listener;
+    }
+    // the new reader may already have data available
+    if (l) l();
+}
+
+template <typename T, typename U>
+bool Module<T, U>::isSuspended() {
+    // writers keep track of their readers in atomics, so the common case of nothing having changed needs no lock.
+    // the writer itself is only swapped while no runner is working on the module.
+    bool idle = !hasReaders();
+    if (idle == suspended.load()) return idle;
     std::lock_guard<std::mutex> lock(processMutex);
-    Sink<T>::setReader(reader);
-    if (reader != waitingReader) waitingReader = nullptr;
+    idle = !hasReaders();
+    if (idle != suspended && this->reader != nullptr) {
+        if (idle) {
+            this->reader->suspend();
+        } else {
+            this->reader->resume();
+        }
+    }
+    suspended = idle;
+    return idle;
+}
+
+template <typename T, typename U>
+bool Module<T, U>::hasReaders() {
+    return this->writer == nullptr || this->writer->hasReaders();
+}
+
+template <typename T, typename U>
+void Module<T, U>::takeOver(Module<T, U>* previous) {
+    Reader<T>* reader = previous->getReader();
+    Writer<U>* writer = previous->getWriter();
+    previous->setReader(nullptr);
+    previous->setWriter(nullptr);
+    setReader(reader);
+    setWriter(writer);
+}
+
+template <typename T, typename U>
+void Module<T, U>::setListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(processMutex);
+    this->listener = std::move(listener);
+    if (this->reader != nullptr) this->reader->setListener(this->listener);
+    if (this->writer != nullptr) this->writer->setListener(this->listener);
+}
+
+template <typename T, typename U>
+ModuleStatistics Module<T, U>::getStatistics() {
+    ModuleStatistics stats = UntypedModule::getStatistics();
+    std::lock_guard<std::mutex> lock(processMutex);
+    if (this->reader != nullptr) {
+        stats.samplesIn = this->reader->getReadCount();
+        try {
+            stats.inputFill = this->reader->available();
+        } catch (const BufferError&) {
+            // input is gone, nothing is waiting
+        }
+    }
+    if (this->writer != nullptr) {
+        stats.samplesOut = this->writer->getWriteCount();
+    }
+    return stats;
+}
+
+template <typename T, typename U>
+size_t Module<T, U>::getInputFill() {
+    std::lock_guard<std::mutex> lock(processMutex);
+    if (this->reader == nullptr) return 0;
+    return this->reader->available();
 }
 
 template <typename T, typename U>
@@ -69,18 +239,31 @@ bool AnyLengthModule<T, U>::canProcess() {
 
 template <typename T, typename U>
 size_t AnyLengthModule<T, U>::getWorkSize() {
-    return std::min({this->reader->available(), this->writer->writeable(), maxLength()});
+    size_t blockSize = blockSizePolicy ? blockSizePolicy->getBlockSize() : SIZE_MAX;
+    return std::min({this->reader->available(), this->writer->writeable(), maxLength(), blockSize});
 }
 
 template <typename T, typename U>
 void AnyLengthModule<T, U>::process() {
     std::lock_guard<std::mutex> lock(this->processMutex);
     size_t available = getWorkSize();
-    process(this->reader->getReadPointer(), this->writer->getWritePointer(), available);
+    if (blockSizePolicy && blockSizePolicy->isAdaptive()) {
+        auto start = std::chrono::steady_clock::now();
+        process(this->reader->getReadPointer(), this->writer->getWritePointer(), available);
+        blockSizePolicy->record(available, nanosecondsSince(start));
+    } else {
+        process(this->reader->getReadPointer(), this->writer->getWritePointer(), available);
+    }
     this->reader->advance(available);
     this->writer->advance(available);
 }
 
+template <typename T, typename U>
+void AnyLengthModule<T, U>::setBlockSizePolicy(const BlockSizePolicy& policy) {
+    std::lock_guard<std::mutex> lock(this->processMutex);
+    blockSizePolicy.reset(new BlockSizePolicy(policy));
+}
+
 template <typename T, typename U>
 bool FixedLengthModule<T, U>::canProcess() {
     std::lock_guard<std::mutex> lock(this->processMutex);
@@ -0,0 +1,191 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "multioutput.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+using namespace Csdr;
+
+template <typename V>
+OutputPort<V>::OutputPort(size_t required): required(required) {}
+
+template <typename V>
+Writer<V>* OutputPort<V>::getWriter() {
+    return writer.load();
+}
+
+template <typename V>
+bool OutputPort<V>::accepts(UntypedWriter* writer) {
+    return dynamic_cast<Writer<V>*>(writer) != nullptr;
+}
+
+template <typename V>
+size_t OutputPort<V>::requiredSpace() {
+    return required;
+}
+
+template <typename V>
+void OutputPort<V>::setWriter(UntypedWriter* writer) {
+    this->writer = dynamic_cast<Writer<V>*>(writer);
+}
+
+template <typename V>
+bool OutputPort<V>::isConnected() {
+    return writer.load() != nullptr;
+}
+
+template <typename V>
+size_t OutputPort<V>::writeable() {
+    Writer<V>* w = writer.load();
+    if (w == nullptr) return SIZE_MAX;
+    return w->writeable();
+}
+
+template <typename V>
+void OutputPort<V>::write(V value) {
+    Writer<V>* w = writer.load();
+    if (w == nullptr) return;
+    *(w->getWritePointer()) = value;
+    w->advance(1);
+}
+
+template <typename T, typename U>
+MultiOutputModule<T, U>::MultiOutputModule() {
+    // the buffers always report to us. the runner's listener is invoked from there.
+    Module<T, U>::setListener([this] { wake(); });
+}
+
+template <typename T, typename U>
+size_t MultiOutputModule<T, U>::getPortCount() {
+    return ports.size();
+}
+
+template <typename T, typename U>
+UntypedOutputPort* MultiOutputModule<T, U>::getPort(size_t index) {
+    return ports.at(index);
+}
+
+template <typename T, typename U>
+void MultiOutputModule<T, U>::setPortWriter(size_t index, UntypedWriter* writer) {
+    {
+        std::lock_guard<std::mutex> lock(this->processMutex);
+        UntypedOutputPort* port = ports.at(index);
+        if (writer != nullptr && !port->accepts(writer)) {
+            throw std::runtime_error("output port " + std::to_string(index) + " cannot write to a buffer of this type");
+        }
+        UntypedWriter* oldWriter = port->getWriter();
+        if (oldWriter == writer) return;
+        port->setWriter(writer);
+        if (oldWriter != nullptr) oldWriter->setListener(nullptr);
+        if (writer != nullptr) writer->setListener([this] { wake(); });
+    }
+    // waiting for space or for readers on the old writer is pointless now
+    wake();
+}
+
+template <typename T, typename U>
+void MultiOutputModule<T, U>::setListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    this->listener = std::move(listener);
+}
+
+template <typename T, typename U>
+void MultiOutputModule<T, U>::wake() {
+    std::function<void()> l;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeups++;
+        l = listener;
+    }
+    wakeCondition.notify_all();
+    if (l) l();
+}
+
+template <typename T, typename U>
+void MultiOutputModule<T, U>::wait(std::unique_lock<std::mutex>& lock) {
+    uint64_t seen;
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex);
+        seen = wakeups;
+    }
+    bool blocked;
+    {
+        std::lock_guard<std::mutex> processLock(this->processMutex);
+        blocked = this->suspended || portsFull();
+    }
+    // the reader and the main writer can be waited on as usual
+    if (!blocked) {
+        Module<T, U>::wait(lock);
+        return;
+    }
+
+    lock.unlock();
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> wakeLock(wakeMutex);
+        wakeCondition.wait(wakeLock, [this, seen] { return wakeups != seen; });
+    }
+    this->recordWait(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    lock.lock();
+}
+
+template <typename T, typename U>
+void MultiOutputModule<T, U>::unblock() {
+    Module<T, U>::unblock();
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeups++;
+    }
+    wakeCondition.notify_all();
+}
+
+template <typename T, typename U>
+void MultiOutputModule<T, U>::addPort(UntypedOutputPort* port) {
+    std::lock_guard<std::mutex> lock(this->processMutex);
+    ports.push_back(port);
+}
+
+template <typename T, typename U>
+bool MultiOutputModule<T, U>::hasReaders() {
+    if (Module<T, U>::hasReaders()) return true;
+    for (UntypedOutputPort* port : ports) {
+        UntypedWriter* writer = port->getWriter();
+        if (writer != nullptr && writer->hasReaders()) return true;
+    }
+    return false;
+}
+
+template <typename T, typename U>
+bool MultiOutputModule<T, U>::portsFull() {
+    for (UntypedOutputPort* port : ports) {
+        UntypedWriter* writer = port->getWriter();
+        if (writer != nullptr && writer->hasBackpressure() && writer->writeable() < port->requiredSpace()) return true;
+    }
+    return false;
+}
+
+namespace Csdr {
+    template class OutputPort<float>;
+    template class OutputPort<complex<float>>;
+
+    template class MultiOutputModule<float, float>;
+    template class MultiOutputModule<complex<float>, complex<float>>;
+}
@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "multistagedecimator.hpp"
+#include "fmv.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Csdr;
+
+// the most output a stage produces per process() call. also sizes the buffers between the stages.
+static const size_t STAGE_BLOCK = 4096;
+
+HalfbandDecimationStage::HalfbandDecimationStage(float transition, Window* window) {
+    // the outermost taps have to be at an odd distance from the center, or they would be zero
+    taps_length = 4.0 / transition;
+    if (taps_length < 3) taps_length = 3;
+    while (taps_length % 4 != 3) taps_length++;
+
+    auto generator = new LowPassTapGenerator(0.25f, window);
+    float* full = generator->getTaps(taps_length);
+    delete generator;
+
+    size_t middle = taps_length / 2;
+    center = full[middle];
+    // the middle is odd, so the even taps are the ones at an odd distance from it. they are symmetric, so only
+    // the first half of them is kept.
+    folded_length = (middle + 1) / 2;
+    taps = (float*) malloc(sizeof(float) * folded_length);
+    for (size_t k = 0; k < folded_length; k++) {
+        taps[k] = full[k * 2];
+    }
+    free(full);
+}
+
+HalfbandDecimationStage::~HalfbandDecimationStage() {
+    free(taps);
+    free(even);
+}
+
+// the filter is short, so this goes tap by tap over all output samples, which vectorizes across the samples.
+// floats is the number of output floats (I and Q), and even holds the even input samples as floats.
+CSDR_TARGET_CLONES
+static void accumulateHalfband(float* output, const float* even, const float* taps, size_t folded_length, size_t floats) {
+    size_t last = (folded_length * 2 - 1) * 2;
+    for (size_t k = 0; k < folded_length; k++) {
+        const float* front = even + k * 2;
+        const float* back = even + last - k * 2;
+        float tap = taps[k];
+        for (size_t i = 0; i < floats; i++) {
+            output[i] += tap * (front[i] + back[i]);
+        }
+    }
+}
+
+void HalfbandDecimationStage::decimate(complex<float>* input, complex<float>* output, size_t count) {
+    size_t needed = count + folded_length * 2 - 1;
+    if (even_size < needed) {
+        free(even);
+        even = (complex<float>*) malloc(sizeof(complex<float>) * needed);
+        even_size = needed;
+    }
+    for (size_t i = 0; i < needed; i++) {
+        even[i] = input[i * 2];
+    }
+    size_t middle = taps_length / 2;
+    for (size_t i = 0; i < count; i++) {
+        output[i] = center * input[i * 2 + middle];
+    }
+    accumulateHalfband((float*) output, (float*) even, taps, folded_length, count * 2);
+}
+
+FirDecimationStage::FirDecimationStage(unsigned int decimation, float cutoff, float transition, Window* window):
+    decimation(decimation),
+    lowpass(new LowPassFilter<complex<float>>(cutoff, transition, window))
+{}
+
+FirDecimationStage::~FirDecimationStage() {
+    delete lowpass;
+}
+
+void FirDecimationStage::decimate(complex<float>* input, complex<float>* output, size_t count) {
+    lowpass->processSamples(input, 0, decimation, output, count);
+}
+
+MultistageDecimator::MultistageDecimator(unsigned int decimation, float transitionBandwidth, Window* window, float cutoff) {
+    if (decimation == 0) throw std::runtime_error("decimation must be at least 1");
+
+    // halfband stages first, where the rate is highest, then the odd factors from the largest down
+    std::vector<unsigned int> factors;
+    unsigned int remaining = decimation;
+    while (remaining % 2 == 0) {
+        factors.push_back(2);
+        remaining /= 2;
+    }
+    std::vector<unsigned int> odd;
+    for (unsigned int factor = 3; factor * factor <= remaining; factor += 2) {
+        while (remaining % factor == 0) {
+            odd.push_back(factor);
+            remaining /= factor;
+        }
+    }
+    if (remaining > 1) odd.push_back(remaining);
+    factors.insert(factors.end(), odd.rbegin(), odd.rend());
+    if (factors.empty()) factors.push_back(1);
+
+    // frequencies below are relative to the input rate until they are handed to a stage
+    float passband = std::max(cutoff / decimation - transitionBandwidth / 2, 0.0f);
+    float rate = 1.0f;
+    for (size_t i = 0; i < factors.size(); i++) {
+        unsigned int factor = factors[i];
+        float stageCutoff;
+        float stageTransition;
+        if (i == factors.size() - 1) {
+            stageCutoff = cutoff / decimation / rate;
+            stageTransition = transitionBandwidth / rate;
+        } else {
+            // anything that passes between the passband and the aliases of the stopband ends up in the final
+            // transition band, and never below it
+            stageCutoff = 0.5f / factor;
+            stageTransition = (rate / factor - 2 * passband) / rate;
+        }
+        if (factor == 2 && stageCutoff == 0.25f) {
+            stages.push_back(new HalfbandDecimationStage(stageTransition, window));
+        } else {
+            stages.push_back(new FirDecimationStage(factor, stageCutoff, stageTransition, window));
+        }
+        rate /= factor;
+    }
+
+    for (size_t i = 1; i < stages.size(); i++) {
+        size_t capacity = stages[i]->getOverhead() + stages[i]->getDecimation() * STAGE_BLOCK;
+        buffers.push_back({(complex<float>*) malloc(sizeof(complex<float>) * capacity), 0, capacity});
+    }
+
+    // all stages are symmetric filters of odd length, so each one delays by half its length at its own input rate.
+    // FirDecimate centers output sample i on input sample i * decimation + target.
+    size_t target = (LowPassFilter<complex<float>>::filterLength(transitionBandwidth) - 1) / 2;
+    size_t delay = 0;
+    size_t step = 1;
+    for (auto stage : stages) {
+        delay += (stage->getOverhead() - 1) / 2 * step;
+        step *= stage->getDecimation();
+    }
+    if (delay > target) {
+        lead = delay - target;
+        size_t first = stages[0]->getDecimation();
+        size_t capacity = (lead + first - 1) / first * first + stages[0]->getOverhead();
+        leadBuffer = (complex<float>*) malloc(sizeof(complex<float>) * capacity);
+    } else {
+        skip = target - delay;
+    }
+}
+
+MultistageDecimator::~MultistageDecimator() {
+    for (auto stage : stages) delete stage;
+    for (auto& buffer : buffers) free(buffer.data);
+    free(leadBuffer);
+}
+
+size_t MultistageDecimator::stageOutput(size_t index) {
+    size_t available;
+    if (index == 0) {
+        available = reader->available() + lead;
+        if (available < skip) return 0;
+        available -= skip;
+    } else {
+        available = buffers[index - 1].fill;
+    }
+    size_t space = index == stages.size() - 1 ? writer->writeable() : buffers[index].capacity - buffers[index].fill;
+    size_t overhead = stages[index]->getOverhead();
+    if (available < overhead) return 0;
+    return std::min({(available - overhead) / stages[index]->getDecimation(), space, STAGE_BLOCK});
+}
+
+bool MultistageDecimator::canProcess() {
+    std::lock_guard<std::mutex> lock(processMutex);
+    for (size_t i = 0; i < stages.size(); i++) {
+        if (stageOutput(i) > 0) return true;
+    }
+    return false;
+}
+
+void MultistageDecimator::process() {
+    std::lock_guard<std::mutex> lock(processMutex);
+    for (size_t i = 0; i < stages.size(); i++) {
+        size_t count = stageOutput(i);
+        if (count == 0) continue;
+        bool last = i == stages.size() - 1;
+        complex<float>* output = last ? writer->getWritePointer() : buffers[i].data + buffers[i].fill;
+
+        if (i == 0) {
+            if (skip > 0) {
+                reader->advance(skip);
+                skip = 0;
+            }
+            if (lead > 0) {
+                count = decimateLead(output, count);
+            } else {
+                stages[0]->decimate(reader->getReadPointer(), output, count);
+                reader->advance(count * stages[0]->getDecimation());
+            }
+        } else {
+            size_t consumed = count * stages[i]->getDecimation();
+            stages[i]->decimate(buffers[i - 1].data, output, count);
+            StageBuffer& previous = buffers[i - 1];
+            previous.fill -= consumed;
+            std::memmove(previous.data, previous.data + consumed, sizeof(complex<float>) * previous.fill);
+        }
+        if (last) {
+            writer->advance(count);
+        } else {
+            buffers[i].fill += count;
+        }
+    }
+}
+
+size_t MultistageDecimator::decimateLead(complex<float>* output, size_t count) {
+    DecimationStage* first = stages[0];
+    size_t decimation = first->getDecimation();
+    // only up to the point where the zeros have passed, the rest goes straight from the reader again
+    count = std::min(count, (lead + decimation - 1) / decimation);
+    size_t consumed = count * decimation;
+    size_t length = consumed + first->getOverhead();
+    size_t zeros = std::min(lead, length);
+    std::fill(leadBuffer, leadBuffer + zeros, complex<float>(0, 0));
+    std::memcpy(leadBuffer + zeros, reader->getReadPointer(), sizeof(complex<float>) * (length - zeros));
+    first->decimate(leadBuffer, output, count);
+    if (consumed < lead) {
+        lead -= consumed;
+    } else {
+        reader->advance(consumed - lead);
+        lead = 0;
+    }
+    return count;
+}
+
+size_t MultistageDecimator::requiredInput() {
+    // enough for the first stage to produce one sample
+    return stages[0]->getOverhead() + stages[0]->getDecimation();
+}
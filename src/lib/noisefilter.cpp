@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "noisefilter.hpp"
+#include "designcache.hpp"
 
 #include <cstring>
 
@@ -65,10 +66,10 @@ NoiseFilter<T>::NoiseFilter(size_t fftSize, size_t wndSize, unsigned int latency
     overlapBuf    = fftwf_alloc_complex(ovrSize);
     forwardInput  = fftwf_alloc_complex(fftSize);
     forwardOutput = fftwf_alloc_complex(fftSize);
-    forwardPlan   = fftwf_plan_dft_1d(fftSize, forwardInput, forwardOutput, FFTW_FORWARD, CSDR_FFTW_FLAGS);
+    forwardPlan   = DesignCache::getFftPlan(fftSize, FFTW_FORWARD, CSDR_FFTW_FLAGS);
     inverseInput  = fftwf_alloc_complex(fftSize);
     inverseOutput = fftwf_alloc_complex(fftSize);
-    inversePlan   = fftwf_plan_dft_1d(fftSize, inverseInput, inverseOutput, FFTW_BACKWARD, CSDR_FFTW_FLAGS);
+    inversePlan   = DesignCache::getFftPlan(fftSize, FFTW_BACKWARD, CSDR_FFTW_FLAGS);
 
     // Fill with zeros so that the padding works
     for(size_t i = 0; i < fftSize; i++)
@@ -81,10 +82,8 @@ NoiseFilter<T>::NoiseFilter(size_t fftSize, size_t wndSize, unsigned int latency
 template<typename T>
 NoiseFilter<T>::~NoiseFilter()
 {
-    fftwf_destroy_plan(forwardPlan);
     fftwf_free(forwardInput);
     fftwf_free(forwardOutput);
-    fftwf_destroy_plan(inversePlan);
     fftwf_free(inverseInput);
     fftwf_free(inverseOutput);
     fftwf_free(overlapBuf);
@@ -109,7 +108,7 @@ size_t NoiseFilter<T>::apply(T *input, T *output, size_t size)
         data[i] = input[i];
 
     // Calculate FFT on input buffer
-    fftwf_execute(forwardPlan);
+    fftwf_execute_dft(forwardPlan, forwardInput, forwardOutput);
 
     auto* in = (complex<float>*) forwardOutput;
     auto* out = (complex<float>*) inverseInput;
@@ -164,7 +163,7 @@ size_t NoiseFilter<T>::apply(T *input, T *output, size_t size)
         out[i] = gain[i]? in[i] * std::sqrt((float)gain[i]/(wndSize*2)) : 0.0f;
 
     // Calculate inverse FFT on the filtered buffer
-    fftwf_execute(inversePlan);
+    fftwf_execute_dft(inversePlan, inverseInput, inverseOutput);
 
     // Add the overlap of the previous segment
     auto result = (complex<float>*) inverseOutput;
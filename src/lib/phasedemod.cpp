@@ -21,6 +21,10 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 
 using namespace Csdr;
 
+PhaseDemod::PhaseDemod() {
+    setBlockSizePolicy(BlockSizePolicy(1024));
+}
+
 void PhaseDemod::process(complex<float> *input, float *output, size_t work_size) {
     for (size_t i = 0; i < work_size; i++) {
         output[i] = std::arg(input[i]);
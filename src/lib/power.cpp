@@ -29,13 +29,15 @@ Power<T>::Power(size_t length, unsigned int decimation, std::function<void(float
     length(std::max(length, (size_t)1)),
     decimation(std::max(decimation, (unsigned int)1)),
     callback(std::move(callback))
-{}
+{
+    this->addPort(&measurements);
+}
 
 template <typename T>
 bool Power<T>::canProcess() {
     std::lock_guard<std::mutex> lock(this->processMutex);
     size_t length = this->getLength();
-    return (this->reader->available() > length && this->writer->writeable() > length);
+    return (this->reader->available() > length && this->writer->writeable() > length && measurements.writeable() > 0);
 }
 
 template <typename T>
@@ -54,6 +56,7 @@ void Power<T>::process() {
 
     // report power
     if (callback) callback(power);
+    measurements.write(power);
 
     // pass data
     forwardData(input, power);
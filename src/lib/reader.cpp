@@ -38,20 +38,40 @@ T* MemoryReader<T>::getReadPointer() {
 template <typename T>
 void MemoryReader<T>::advance(size_t how_much) {
     read_pos += how_much;
+    read_count.store(read_count.load(std::memory_order_relaxed) + how_much, std::memory_order_relaxed);
 }
 
 template <typename T>
 void MemoryReader<T>::wait() {
-    // not implemented. the data should be in memory already.
+    std::unique_lock<std::mutex> lock(waitMutex);
+    waitCondition.wait(lock, [this] { return unblocked || available() > 0; });
+}
+
+template <typename T>
+void MemoryReader<T>::unblock() {
+    std::lock_guard<std::mutex> lock(waitMutex);
+    unblocked = true;
+    waitCondition.notify_all();
 }
 
 template <typename T>
 void MemoryReader<T>::rewind() {
+    std::lock_guard<std::mutex> lock(waitMutex);
     read_pos = 0;
+    waitCondition.notify_all();
+}
+
+template <typename T>
+uint64_t MemoryReader<T>::getReadCount() {
+    return read_count.load(std::memory_order_relaxed);
 }
 
 namespace Csdr {
-    template class MemoryReader<complex<float>>;
-    template class MemoryReader<float>;
+    template class MemoryReader<char>;
+    template class MemoryReader<unsigned char>;
     template class MemoryReader<short>;
+    template class MemoryReader<float>;
+    template class MemoryReader<complex<unsigned char>>;
+    template class MemoryReader<complex<short>>;
+    template class MemoryReader<complex<float>>;
 }
\ No newline at end of file
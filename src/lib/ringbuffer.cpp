@@ -21,26 +21,152 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "complex.hpp"
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <climits>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
 
 using namespace Csdr;
 
+static void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+    // returns immediately if the value has already changed, so no wakeup can get lost between check and sleep
+    ::syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t>* addr) {
+    ::syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#ifdef PAGESIZE
+static constexpr size_t PAGE_SIZE = PAGESIZE;
+#else
+static const size_t PAGE_SIZE = ::sysconf(_SC_PAGESIZE);
+#endif
+
+static size_t huge_page_size() {
+    static size_t huge_page_size = 0;
+    if (huge_page_size == 0) {
+        // default for most architectures, unless the kernel tells us otherwise
+        huge_page_size = 2 * 1024 * 1024;
+        std::ifstream meminfo("/proc/meminfo");
+        std::string line;
+        while (std::getline(meminfo, line)) {
+            unsigned long kb;
+            if (sscanf(line.c_str(), "Hugepagesize: %lu kB", &kb) == 1) {
+                huge_page_size = kb * 1024;
+                break;
+            }
+        }
+    }
+    return huge_page_size;
+}
+
 template <typename T>
-Ringbuffer<T>::Ringbuffer(size_t size) {
-    data = allocate_mirrored(size);
+Ringbuffer<T>::Ringbuffer(size_t size, RingbufferMemory memory): snapshot(new Snapshot()) {
+    snapshotUsers[0].store(0);
+    snapshotUsers[1].store(0);
+    data = allocate_mirrored(size, memory);
     if (data == nullptr) {
+        delete snapshot.load();
         throw BufferError("unable to allocate ringbuffer memory");
     }
 }
 
 template <typename T>
-T* Ringbuffer<T>::allocate_mirrored(size_t size) {
+T* Ringbuffer<T>::allocate_mirrored(size_t size, RingbufferMemory memory) {
+    T* result;
+    switch (memory) {
+        case RingbufferMemory::HUGEPAGES:
+            result = allocate_memfd(size, true);
+            if (result != nullptr) {
+                this->memory = RingbufferMemory::HUGEPAGES;
+                return result;
+            }
+            // no huge pages reserved. transparent huge pages are the next best thing.
+            result = allocate_memfd(size, false);
+            if (result != nullptr) {
+                ::madvise(result, 2 * this->size * sizeof(T), MADV_HUGEPAGE);
+                this->memory = RingbufferMemory::HUGEPAGES;
+                return result;
+            }
+            // fallthrough
+        case RingbufferMemory::MEMFD:
+            result = allocate_memfd(size, false);
+            if (result != nullptr) {
+                this->memory = RingbufferMemory::MEMFD;
+                return result;
+            }
+            // fallthrough
+        case RingbufferMemory::ANONYMOUS:
+        default:
+            this->memory = RingbufferMemory::ANONYMOUS;
+            return allocate_anonymous(size);
+    }
+}
 
-#ifdef PAGESIZE
-	static constexpr unsigned int PAGE_SIZE = PAGESIZE;
+template <typename T>
+T* Ringbuffer<T>::allocate_memfd(size_t size, bool hugetlb) {
+#ifdef SYS_memfd_create
+    size_t page_size = hugetlb ? huge_page_size() : PAGE_SIZE;
+    size_t bytes = ((sizeof(T) * size + page_size - 1) / page_size) * page_size;
+    if (bytes % sizeof(T)) {
+        return nullptr;
+    }
+
+    unsigned int flags = MFD_CLOEXEC;
+    if (hugetlb) flags |= MFD_HUGETLB;
+    int fd = (int) ::syscall(SYS_memfd_create, "csdr-ringbuffer", flags);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (::ftruncate(fd, (off_t) bytes) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // reserve an address range for both copies, with some slack to align huge pages
+    size_t reserved = 2 * bytes + page_size;
+    auto reservation = static_cast<unsigned char*>(::mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (reservation == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+    auto addr = reinterpret_cast<unsigned char*>(((uintptr_t) reservation + page_size - 1) & ~(uintptr_t) (page_size - 1));
+
+    // the fixed mappings replace the reservation, so there is no window for somebody else to grab the address range
+    auto first = ::mmap(addr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    auto second = first == MAP_FAILED ? MAP_FAILED : ::mmap(addr + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (first == MAP_FAILED || second == MAP_FAILED) {
+        // hugetlb mappings fail here if the huge page pool is exhausted
+        ::munmap(reservation, reserved);
+        ::close(fd);
+        return nullptr;
+    }
+
+    // release the slack on both ends
+    if (addr > reservation) {
+        ::munmap(reservation, addr - reservation);
+    }
+    size_t tail = (reservation + reserved) - (addr + 2 * bytes);
+    if (tail > 0) {
+        ::munmap(addr + 2 * bytes, tail);
+    }
+
+    this->fd = fd;
+    this->size = bytes / sizeof(T);
+    return (T*) addr;
 #else
-	static const unsigned int PAGE_SIZE = ::sysconf(_SC_PAGESIZE);
+    return nullptr;
 #endif
+}
 
+template <typename T>
+T* Ringbuffer<T>::allocate_anonymous(size_t size) {
     size_t bytes = ((sizeof(T) * size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
     if (bytes % sizeof(T)) {
         throw BufferError("unable to align buffer with page size");
@@ -80,8 +206,14 @@ T* Ringbuffer<T>::allocate_mirrored(size_t size) {
 
 template <typename T>
 Ringbuffer<T>::~Ringbuffer() {
-    for (RingbufferReader<T>* reader : readers) {
-        reader->onBufferDelete();
+    {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        for (RingbufferReader<T>* reader : readers) {
+            reader->onBufferDelete();
+        }
+        for (RingbufferReader<T>* reader : suspendedReaders) {
+            reader->onBufferDelete();
+        }
     }
     if (data != nullptr) {
         auto addr = (unsigned char*) data;
@@ -90,12 +222,30 @@ Ringbuffer<T>::~Ringbuffer() {
         ::munmap(addr + bytes, bytes);
         data = nullptr;
     }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
     unblock();
+    delete snapshot.load();
 }
 
 template <typename T>
 size_t Ringbuffer<T>::writeable() {
-    return size - 1;
+    if (!backpressure.load(std::memory_order_relaxed)) {
+        return size - 1;
+    }
+    uint64_t written = write_count.load(std::memory_order_relaxed);
+    uint64_t lag = 0;
+    // the snapshot is only republished when readers come or go, so this doesn't contend with them advancing
+    uint32_t slot;
+    Snapshot* current = acquireSnapshot(slot);
+    for (const ReaderEntry& entry : current->readers) {
+        lag = std::max(lag, written - entry.reader->getReadCount());
+    }
+    releaseSnapshot(slot);
+    // a lagging reader may already have been overrun before backpressure was enabled
+    return lag < size - 1 ? size - 1 - lag : 0;
 }
 
 template<typename T>
@@ -105,7 +255,7 @@ T* Ringbuffer<T>::getPointer(size_t pos) {
 
 template <typename T>
 T* Ringbuffer<T>::getWritePointer() {
-    return getPointer(write_pos);
+    return getPointer(write_count.load(std::memory_order_relaxed) % size);
 }
 
 template <typename T>
@@ -115,58 +265,321 @@ void Ringbuffer<T>::advance(size_t& what, size_t how_much) {
 
 template <typename T>
 void Ringbuffer<T>::advance(size_t how_much) {
-    advance(write_pos, how_much);
-    unblock();
+    // only one producer per buffer, so there's no need for a read-modify-write here
+    write_count.store(write_count.load(std::memory_order_relaxed) + how_much, std::memory_order_release);
+    notifyReaders();
 }
 
 template <typename T>
 size_t Ringbuffer<T>::available(size_t read_pos) {
-    return (size + write_pos - read_pos) % size;
+    return (size + getWritePos() - read_pos) % size;
 }
 
 template<typename T>
 size_t Ringbuffer<T>::getWritePos() {
-    return write_pos;
+    return getWriteCount() % size;
+}
+
+template <typename T>
+uint64_t Ringbuffer<T>::getWriteCount() {
+    return write_count.load(std::memory_order_acquire);
+}
+
+template <typename T>
+size_t Ringbuffer<T>::getSize() {
+    return size;
+}
+
+template <typename T>
+RingbufferMemory Ringbuffer<T>::getMemory() {
+    return memory;
+}
+
+template <typename T>
+int Ringbuffer<T>::getFd() {
+    return fd;
+}
+
+template <typename T>
+void Ringbuffer<T>::prefault() {
+    auto bytes = size * sizeof(T);
+    auto addr = (volatile unsigned char*) data;
+    // writing allocates the pages, reading the mirror sets up its page table entries
+    for (size_t i = 0; i < bytes; i += PAGE_SIZE) addr[i] = 0;
+    for (size_t i = bytes; i < 2 * bytes; i += PAGE_SIZE) (void) addr[i];
+}
+
+template <typename T>
+void Ringbuffer<T>::wakeWaiters() {
+    generation.fetch_add(1);
+    // the syscall is only necessary if somebody is actually sleeping
+    if (waiters.load() > 0) {
+        futex_wake(&generation);
+    }
+}
+
+template <typename T>
+void Ringbuffer<T>::notifyReaders() {
+    wakeWaiters();
+    // pairs with the fence in wait(RingbufferReader*): either the reader sees the new data, or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load() > 0 || listeners.load() > 0) {
+        uint32_t slot;
+        Snapshot* current = acquireSnapshot(slot);
+        for (const ReaderEntry& entry : current->readers) {
+            RingbufferReader<T>* reader = entry.reader;
+            // readers are only woken once there is enough data for them to make progress
+            if (!reader->isReady()) continue;
+            if (reader->sleeping.load()) {
+                reader->wakeup.fetch_add(1);
+                futex_wake(&reader->wakeup);
+            }
+            if (entry.listener) entry.listener();
+        }
+        releaseSnapshot(slot);
+    }
+}
+
+template <typename T>
+void Ringbuffer<T>::notifyWriter() {
+    wakeWaiters();
+    if (writerListening.load()) {
+        uint32_t slot;
+        Snapshot* current = acquireSnapshot(slot);
+        if (current->writerListener) current->writerListener();
+        releaseSnapshot(slot);
+    }
+}
+
+template <typename T>
+typename Ringbuffer<T>::Snapshot* Ringbuffer<T>::acquireSnapshot(uint32_t& slot) {
+    while (true) {
+        uint32_t current = epoch.load();
+        slot = current & 1;
+        snapshotUsers[slot].fetch_add(1);
+        // if the epoch is still the same, publish() is bound to wait for us before it deletes anything we may load
+        if (epoch.load() == current) return snapshot.load();
+        snapshotUsers[slot].fetch_sub(1);
+    }
+}
+
+template <typename T>
+void Ringbuffer<T>::releaseSnapshot(uint32_t slot) {
+    snapshotUsers[slot].fetch_sub(1);
+}
+
+template <typename T>
+void Ringbuffer<T>::publish() {
+    auto next = new Snapshot();
+    int count = 0;
+    next->readers.reserve(readers.size());
+    for (RingbufferReader<T>* reader : readers) {
+        next->readers.push_back(ReaderEntry{reader, reader->listener});
+        if (reader->listener) count++;
+    }
+    next->writerListener = writerListener;
+    Snapshot* previous = snapshot.exchange(next);
+    listeners.store(count);
+    writerListening.store((bool) writerListener);
+    activeReaders.store(readers.size());
+    // anybody still counted in the old slot may be looking at the previous snapshot, or at readers and listeners
+    // that the caller is about to get rid of.
+    uint32_t slot = epoch.fetch_add(1) & 1;
+    while (snapshotUsers[slot].load() > 0) std::this_thread::yield();
+    delete previous;
 }
 
 template <typename T>
 void Ringbuffer<T>::wait() {
+    // there is only one producer, so it's safe to keep its state here
+    wait(writer_generation);
+}
+
+template <typename T>
+void Ringbuffer<T>::wait(uint32_t& seen) {
+    if (data == nullptr) {
+        throw BufferError("Buffer is not initialized or shutting down, cannot wait()");
+    }
+    uint32_t current = generation.load();
+    if (current == seen) {
+        waiters.fetch_add(1);
+        futex_wait(&generation, current);
+        waiters.fetch_sub(1);
+        current = generation.load();
+    }
+    seen = current;
+}
+
+template <typename T>
+void Ringbuffer<T>::wait(RingbufferReader<T>* reader) {
     if (data == nullptr) {
         throw BufferError("Buffer is not initialized or shutting down, cannot wait()");
     }
-    std::unique_lock<std::mutex> lk(mutex);
-    condition.wait(lk);
+    // if the threshold is met already, something else holds the reader back. fall back to waiting for any change.
+    if (reader->threshold.load(std::memory_order_relaxed) <= 1 || reader->isReady()) {
+        wait(reader->generation);
+        return;
+    }
+    uint32_t seen = reader->wakeup.load();
+    reader->sleeping.store(true);
+    sleepers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!reader->isReady()) {
+        futex_wait(&reader->wakeup, seen);
+    }
+    sleepers.fetch_sub(1);
+    reader->sleeping.store(false);
 }
 
 template <typename T>
 void Ringbuffer<T>::unblock() {
-    std::lock_guard<std::mutex> lk(mutex);
-    condition.notify_all();
+    generation.fetch_add(1);
+    futex_wake(&generation);
+    std::lock_guard<std::mutex> lock(readersMutex);
+    for (RingbufferReader<T>* reader : readers) {
+        reader->wakeup.fetch_add(1);
+        futex_wake(&reader->wakeup);
+    }
+    for (RingbufferReader<T>* reader : suspendedReaders) {
+        reader->wakeup.fetch_add(1);
+        futex_wake(&reader->wakeup);
+    }
+}
+
+template <typename T>
+void Ringbuffer<T>::setBackpressure(bool backpressure) {
+    this->backpressure.store(backpressure);
+    // a producer may be waiting for space, and the rules have just changed
+    unblock();
+}
+
+template <typename T>
+bool Ringbuffer<T>::hasBackpressure() {
+    return backpressure.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void Ringbuffer<T>::setListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(readersMutex);
+    writerListener = std::move(listener);
+    publish();
+}
+
+template <typename T>
+void Ringbuffer<T>::setListener(RingbufferReader<T>* reader, std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(readersMutex);
+    reader->listener = std::move(listener);
+    // publish() guarantees that the old listener is not invoked anymore once we return
+    publish();
 }
 
 template <typename T>
 void Ringbuffer<T>::addReader(RingbufferReader<T> *reader) {
-    if (readers.find(reader) != readers.end()) {
-        // already in set
-        return;
+    {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        if (readers.find(reader) != readers.end()) {
+            // already in set
+            return;
+        }
+        readers.insert(reader);
+        publish();
     }
-    readers.insert(reader);
+    // wakes up the writer in case it has been suspended for the lack of readers
+    notifyWriter();
 }
 
 template <typename T>
 void Ringbuffer<T>::removeReader(RingbufferReader<T> *reader) {
-    auto position = readers.find(reader);
-    if (position == readers.end()) {
-        // not in set
-        return;
+    {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        suspendedReaders.erase(reader);
+        auto position = readers.find(reader);
+        if (position == readers.end()) {
+            // not in set
+            return;
+        }
+        readers.erase(position);
+        // the reader may be deleted as soon as we return, so notifyReaders() must be done with it
+        publish();
+    }
+    // the slowest reader may just have gone away
+    if (hasBackpressure()) notifyWriter();
+}
+
+template <typename T>
+void Ringbuffer<T>::suspendReader(RingbufferReader<T>* reader) {
+    {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        auto position = readers.find(reader);
+        if (position == readers.end()) return;
+        readers.erase(position);
+        suspendedReaders.insert(reader);
+        publish();
+    }
+    // the slowest reader may just have gone away
+    if (hasBackpressure()) notifyWriter();
+}
+
+template <typename T>
+void Ringbuffer<T>::resumeReader(RingbufferReader<T>* reader) {
+    {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        auto position = suspendedReaders.find(reader);
+        if (position == suspendedReaders.end()) return;
+        suspendedReaders.erase(position);
+        // whatever was written in the meantime is of no interest anymore
+        uint64_t start = reader->upstream != nullptr ? reader->upstream->getReadCount() : write_count.load();
+        reader->read_count.store(start, std::memory_order_release);
+        // followers must not see the samples their upstream has skipped
+        for (RingbufferReader<T>* follower : readers) {
+            if (follower->upstream == reader) follower->read_count.store(start, std::memory_order_release);
+        }
+        for (RingbufferReader<T>* follower : suspendedReaders) {
+            if (follower->upstream == reader) follower->read_count.store(start, std::memory_order_release);
+        }
+        readers.insert(reader);
+        publish();
+        // a suspended in-place module only finds out about its follower through the follower's upstream
+        if (reader->upstream != nullptr && reader->upstream->listener) reader->upstream->listener();
+    }
+    // wakes up the writer in case it has been suspended for the lack of readers
+    notifyWriter();
+}
+
+template <typename T>
+bool Ringbuffer<T>::hasReaders() {
+    // called by the runners all the time (see Module::isSuspended()), so this must not take the lock
+    return activeReaders.load() > 0;
+}
+
+template <typename T>
+bool Ringbuffer<T>::hasFollowers(RingbufferReader<T>* reader) {
+    bool found = false;
+    uint32_t slot;
+    Snapshot* current = acquireSnapshot(slot);
+    for (const ReaderEntry& entry : current->readers) {
+        if (entry.reader->upstream == reader) {
+            found = true;
+            break;
+        }
     }
-    readers.erase(position);
+    releaseSnapshot(slot);
+    return found;
 }
 
 template <typename T>
 RingbufferReader<T>::RingbufferReader(Ringbuffer<T>* buffer):
     buffer(buffer),
-    read_pos(buffer->getWritePos())
+    read_count(buffer->getWriteCount())
+{
+    buffer->addReader(this);
+}
+
+template <typename T>
+RingbufferReader<T>::RingbufferReader(Ringbuffer<T>* buffer, RingbufferReader<T>* upstream):
+    buffer(buffer),
+    upstream(upstream),
+    read_count(upstream->getReadCount())
 {
     buffer->addReader(this);
 }
@@ -183,7 +596,24 @@ size_t RingbufferReader<T>::available() {
     if (buffer == nullptr) {
         throw BufferError("Buffer no longer available");
     }
-    return buffer->available(read_pos);
+    uint64_t written = buffer->getWriteCount();
+    uint64_t read = read_count.load(std::memory_order_relaxed);
+    size_t limit = buffer->getSize() - 1;
+    if (written - read > limit) {
+        // the writer has lapped us. skip ahead to the oldest data that is still valid.
+        uint64_t oldest = written - limit;
+        dropped.fetch_add(oldest - read, std::memory_order_relaxed);
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        read_count.store(oldest, std::memory_order_release);
+        read = oldest;
+    }
+    if (upstream != nullptr) {
+        // samples beyond the upstream position have not been processed yet
+        uint64_t processed = upstream->getReadCount();
+        if (processed < read) return 0;
+        return std::min(written, processed) - read;
+    }
+    return written - read;
 }
 
 template <typename T>
@@ -191,7 +621,7 @@ T* RingbufferReader<T>::getReadPointer() {
     if (buffer == nullptr) {
         throw BufferError("Buffer no longer available");
     }
-    return buffer->getPointer(read_pos);
+    return buffer->getPointer(read_count.load(std::memory_order_relaxed) % buffer->getSize());
 }
 
 template <typename T>
@@ -199,7 +629,9 @@ void RingbufferReader<T>::advance(size_t how_much) {
     if (buffer == nullptr) {
         throw BufferError("Buffer no longer available");
     }
-    buffer->advance(read_pos, how_much);
+    read_count.store(read_count.load(std::memory_order_relaxed) + how_much, std::memory_order_release);
+    // a producer may be waiting for us to make room
+    if (buffer->hasBackpressure()) buffer->notifyWriter();
 }
 
 template <typename T>
@@ -207,7 +639,8 @@ void RingbufferReader<T>::wait() {
     if (buffer == nullptr) {
         throw BufferError("Buffer no longer available");
     }
-    buffer->wait();
+    // wakes up on any change since our last wait(), including changes that happened while we were processing
+    buffer->wait(this);
 }
 
 template <typename T>
@@ -216,31 +649,146 @@ void RingbufferReader<T>::unblock() {
     buffer->unblock();
 }
 
+template <typename T>
+void RingbufferReader<T>::setListener(std::function<void()> listener) {
+    if (buffer == nullptr) return;
+    buffer->setListener(this, std::move(listener));
+}
+
+template <typename T>
+void RingbufferReader<T>::setWakeThreshold(size_t threshold) {
+    this->threshold.store(threshold, std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t RingbufferReader<T>::pending() {
+    uint64_t read = read_count.load(std::memory_order_acquire);
+    uint64_t written = buffer->getWriteCount();
+    if (upstream != nullptr) {
+        uint64_t processed = upstream->getReadCount();
+        if (processed < read) return 0;
+        written = std::min(written, processed);
+    }
+    return written - read;
+}
+
+template <typename T>
+bool RingbufferReader<T>::isReady() {
+    // a threshold beyond the buffer size could never be reached
+    size_t required = std::min(threshold.load(std::memory_order_relaxed), buffer->getSize() - 1);
+    return pending() >= required;
+}
+
+template <typename T>
+void RingbufferReader<T>::suspend() {
+    if (buffer == nullptr) return;
+    buffer->suspendReader(this);
+}
+
+template <typename T>
+void RingbufferReader<T>::resume() {
+    if (buffer == nullptr) return;
+    buffer->resumeReader(this);
+}
+
 template <typename T>
 void RingbufferReader<T>::onBufferDelete() {
     buffer = nullptr;
 }
 
+template <typename T>
+uint64_t RingbufferReader<T>::getReadCount() {
+    return read_count.load(std::memory_order_acquire);
+}
+
+template <typename T>
+size_t RingbufferReader<T>::getOverruns() {
+    return overruns.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t RingbufferReader<T>::getDroppedSamples() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+InPlaceWriter<T>::InPlaceWriter(RingbufferReader<T>* reader): reader(reader) {}
+
+template <typename T>
+size_t InPlaceWriter<T>::writeable() {
+    return reader->available();
+}
+
+template <typename T>
+T* InPlaceWriter<T>::getWritePointer() {
+    return reader->getReadPointer();
+}
+
+template <typename T>
+void InPlaceWriter<T>::advance(size_t how_much) {
+    // the reader has already been advanced past the processed samples at this point, which has woken up the writer
+    // if necessary. the followers still have to find out.
+    auto buffer = reader->buffer;
+    if (buffer == nullptr) {
+        throw BufferError("Buffer no longer available");
+    }
+    write_count.store(write_count.load(std::memory_order_relaxed) + how_much, std::memory_order_relaxed);
+    buffer->notifyReaders();
+}
+
+template <typename T>
+uint64_t InPlaceWriter<T>::getWriteCount() {
+    return write_count.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+bool InPlaceWriter<T>::hasReaders() {
+    auto buffer = reader->buffer;
+    return buffer == nullptr || buffer->hasFollowers(reader);
+}
+
+template <typename T>
+void InPlaceWriter<T>::wait() {
+    auto buffer = reader->buffer;
+    if (buffer == nullptr) {
+        throw BufferError("Buffer no longer available");
+    }
+    buffer->wait(generation);
+}
+
+template <typename T>
+void InPlaceWriter<T>::unblock() {
+    auto buffer = reader->buffer;
+    if (buffer != nullptr) buffer->unblock();
+}
+
 namespace Csdr {
     // compile templates for all the possible variations
     template class Ringbuffer<char>;
     template class RingbufferReader<char>;
+    template class InPlaceWriter<char>;
 
     template class Ringbuffer<unsigned char>;
     template class RingbufferReader<unsigned char>;
+    template class InPlaceWriter<unsigned char>;
 
     template class Ringbuffer<short>;
     template class RingbufferReader<short>;
+    template class InPlaceWriter<short>;
 
     template class Ringbuffer<float>;
     template class RingbufferReader<float>;
+    template class InPlaceWriter<float>;
 
     template class Ringbuffer<complex<unsigned char>>;
     template class RingbufferReader<complex<unsigned char>>;
+    template class InPlaceWriter<complex<unsigned char>>;
 
     template class Ringbuffer<complex<short>>;
     template class RingbufferReader<complex<short>>;
+    template class InPlaceWriter<complex<short>>;
 
     template class Ringbuffer<complex<float>>;
     template class RingbufferReader<complex<float>>;
+    template class InPlaceWriter<complex<float>>;
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "segmented.hpp"
+#include "complex.hpp"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace Csdr;
+
+// input per segment. large enough that starting the threads does not matter.
+static const size_t segmentSize = 1 << 18;
+
+template <typename T, typename U>
+bool SegmentedModule<T, U>::processSegmented(unsigned int threads) {
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t alignment = std::max(getSegmentAlignment(), (size_t) 1);
+    size_t length = ((segmentSize + alignment - 1) / alignment) * alignment;
+
+    std::vector<SegmentWorker<T, U>*> workers;
+    std::vector<U*> outputs;
+    for (unsigned int i = 0; i < threads; i++) {
+        auto worker = createSegmentWorker();
+        if (worker == nullptr) break;
+        workers.push_back(worker);
+        outputs.push_back((U*) malloc(sizeof(U) * getSegmentOutput(length)));
+    }
+    if (workers.size() < threads) {
+        for (auto worker : workers) delete worker;
+        for (auto output : outputs) free(output);
+        return false;
+    }
+
+    std::vector<size_t> produced(threads);
+    while (true) {
+        std::lock_guard<std::mutex> lock(this->processMutex);
+        // without any input consumed, the module is still in its initial state
+        bool atStart = this->reader->getReadCount() == 0;
+        // process() could not go any further than this, so neither do we
+        size_t overhead = getSegmentOverhead() + 1;
+        size_t available = this->reader->available();
+        if (available <= overhead) break;
+        size_t bulk = ((available - overhead) / alignment) * alignment;
+        if (bulk == 0) break;
+
+        T* input = this->reader->getReadPointer();
+        std::vector<std::thread> running;
+        size_t consumed = 0;
+        for (unsigned int i = 0; i < threads && consumed < bulk; i++) {
+            size_t segment = std::min(length, bulk - consumed);
+            bool first = atStart && consumed == 0;
+            running.emplace_back([&workers, &outputs, &produced, i, input, consumed, segment, first] {
+                produced[i] = workers[i]->process(input + consumed, segment, outputs[i], first);
+            });
+            consumed += segment;
+        }
+        for (auto& thread : running) thread.join();
+
+        // stitch the segments together in order
+        for (size_t i = 0; i < running.size(); i++) {
+            size_t written = 0;
+            while (written < produced[i]) {
+                size_t writeable = std::min(this->writer->writeable(), produced[i] - written);
+                if (writeable == 0) {
+                    this->writer->wait();
+                    continue;
+                }
+                std::memcpy(this->writer->getWritePointer(), outputs[i] + written, sizeof(U) * writeable);
+                this->writer->advance(writeable);
+                written += writeable;
+            }
+        }
+
+        this->reader->advance(consumed);
+        skipTo(input + consumed);
+    }
+
+    for (auto worker : workers) delete worker;
+    for (auto output : outputs) free(output);
+    return true;
+}
+
+namespace Csdr {
+    template class SegmentedModule<complex<float>, complex<float>>;
+    template class SegmentedModule<float, float>;
+}
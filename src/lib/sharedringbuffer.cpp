@@ -0,0 +1,358 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sharedringbuffer.hpp"
+#include "ringbuffer.hpp"
+#include "complex.hpp"
+
+#include <new>
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+
+using namespace Csdr;
+
+static const uint32_t SHARED_RINGBUFFER_MAGIC = 0x43534452;
+
+#ifdef PAGESIZE
+static constexpr size_t PAGE_SIZE = PAGESIZE;
+#else
+static const size_t PAGE_SIZE = ::sysconf(_SC_PAGESIZE);
+#endif
+
+// how often a sleeping side checks whether the other process is still alive
+static const struct timespec livenessInterval = { .tv_sec = 0, .tv_nsec = 100000000 };
+
+// not FUTEX_*_PRIVATE, since the other side lives in another process
+static int futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+    return (int) ::syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAIT, expected, &livenessInterval, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t>* addr) {
+    ::syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+static bool timedOut(int rc) {
+    return rc != 0 && errno == ETIMEDOUT;
+}
+
+static bool isAlive(pid_t pid) {
+    return pid <= 0 || ::kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// sleeps on a futex word of the other side
+static int sleepOn(std::atomic<uint32_t>* word, std::atomic<uint32_t>* sleeping, uint32_t expected) {
+    sleeping->fetch_add(1);
+    int rc = futex_wait(word, expected);
+    int error = errno;
+    sleeping->fetch_sub(1);
+    errno = error;
+    return rc;
+}
+
+// invokes the listener whenever the word changes, until watching is cleared
+static void watch(std::atomic<uint32_t>* word, std::atomic<uint32_t>* sleeping, std::atomic<bool>& watching, std::mutex& listenerMutex, std::function<void()>& listener) {
+    uint32_t seen = word->load();
+    while (watching.load()) {
+        sleepOn(word, sleeping, seen);
+        uint32_t current = word->load();
+        if (current == seen) continue;
+        seen = current;
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        if (listener) listener();
+    }
+}
+
+// maps the control page, followed by the samples twice. returns nullptr on failure.
+static SharedRingbufferControl* mapShared(int fd, size_t bytes) {
+    size_t total = PAGE_SIZE + 2 * bytes;
+    auto reservation = static_cast<unsigned char*>(::mmap(NULL, total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (reservation == MAP_FAILED) return nullptr;
+    // the fixed mappings replace the reservation, same as in Ringbuffer
+    if (
+        ::mmap(reservation, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        ::mmap(reservation + PAGE_SIZE, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, PAGE_SIZE) == MAP_FAILED ||
+        ::mmap(reservation + PAGE_SIZE + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, PAGE_SIZE) == MAP_FAILED
+    ) {
+        ::munmap(reservation, total);
+        return nullptr;
+    }
+    return (SharedRingbufferControl*) reservation;
+}
+
+static void unmapShared(SharedRingbufferControl* control, size_t bytes) {
+    ::munmap(control, PAGE_SIZE + 2 * bytes);
+}
+
+template <typename T>
+SharedRingbuffer<T>::SharedRingbuffer(size_t size) {
+    static_assert(sizeof(SharedRingbufferControl) <= 4096, "control block must fit into one page");
+    // anything else would not work across processes
+    if (!std::atomic<uint64_t>().is_lock_free()) {
+        throw BufferError("shared ringbuffers require lock-free 64 bit atomics");
+    }
+    size_t bytes = ((sizeof(T) * size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+    if (bytes % sizeof(T)) {
+        throw BufferError("unable to align buffer with page size");
+    }
+
+    fd = (int) ::syscall(SYS_memfd_create, "csdr-shared-ringbuffer", MFD_CLOEXEC);
+    if (fd < 0) {
+        throw BufferError(std::string("unable to create shared memory: ") + strerror(errno));
+    }
+    if (::ftruncate(fd, (off_t) (PAGE_SIZE + bytes)) != 0 || (control = mapShared(fd, bytes)) == nullptr) {
+        std::string error = strerror(errno);
+        ::close(fd);
+        throw BufferError("unable to map shared memory: " + error);
+    }
+
+    new (control) SharedRingbufferControl();
+    control->magic = SHARED_RINGBUFFER_MAGIC;
+    control->elementSize = sizeof(T);
+    control->size = bytes / sizeof(T);
+    control->writerPid = ::getpid();
+    this->size = bytes / sizeof(T);
+    data = (T*) ((unsigned char*) control + PAGE_SIZE);
+}
+
+template <typename T>
+SharedRingbuffer<T>::~SharedRingbuffer() {
+    if (watcher.joinable()) {
+        watching.store(false);
+        futex_wake(&control->consumed);
+        watcher.join();
+    }
+    control->closed.store(1);
+    control->written.fetch_add(1);
+    futex_wake(&control->written);
+    futex_wake(&control->closed);
+    unmapShared(control, size * sizeof(T));
+    ::close(fd);
+}
+
+template <typename T>
+bool SharedRingbuffer<T>::readerGone() {
+    return control->detached.load(std::memory_order_relaxed) != 0;
+}
+
+template <typename T>
+size_t SharedRingbuffer<T>::writeable() {
+    // nobody is going to read what we overwrite
+    if (readerGone()) return size - 1;
+    uint64_t lag = control->write_count.load(std::memory_order_relaxed) - control->read_count.load(std::memory_order_acquire);
+    return lag < size - 1 ? size - 1 - lag : 0;
+}
+
+template <typename T>
+T* SharedRingbuffer<T>::getWritePointer() {
+    return data + control->write_count.load(std::memory_order_relaxed) % size;
+}
+
+template <typename T>
+void SharedRingbuffer<T>::advance(size_t how_much) {
+    // only one producer per buffer, so there's no need for a read-modify-write here
+    control->write_count.store(control->write_count.load(std::memory_order_relaxed) + how_much, std::memory_order_release);
+    control->written.fetch_add(1);
+    if (control->readerSleeping.load()) futex_wake(&control->written);
+}
+
+template <typename T>
+void SharedRingbuffer<T>::wait() {
+    // there is only one producer, so it's safe to keep its state here
+    uint32_t current = control->consumed.load();
+    // without a reader, nothing will wake us up, but the timeout keeps a suspended writer from spinning
+    if (current == writerSeen && !unblocked.load()) {
+        int rc = sleepOn(&control->consumed, &control->writerSleeping, current);
+        if (timedOut(rc) && !isAlive(control->readerPid.load())) control->detached.store(1);
+        current = control->consumed.load();
+    }
+    writerSeen = current;
+}
+
+template <typename T>
+bool SharedRingbuffer<T>::hasReaders() {
+    return !readerGone();
+}
+
+template <typename T>
+void SharedRingbuffer<T>::unblock() {
+    unblocked.store(true);
+    futex_wake(&control->consumed);
+}
+
+template <typename T>
+void SharedRingbuffer<T>::setListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(listenerMutex);
+    this->listener = std::move(listener);
+    if (this->listener && !watcher.joinable()) {
+        watcher = std::thread([this] {
+            watch(&control->consumed, &control->writerSleeping, watching, listenerMutex, this->listener);
+        });
+    }
+}
+
+template <typename T>
+uint64_t SharedRingbuffer<T>::getWriteCount() {
+    return control->write_count.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+int SharedRingbuffer<T>::getFd() {
+    return fd;
+}
+
+template <typename T>
+SharedRingbufferReader<T>::SharedRingbufferReader(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (size_t) st.st_size <= PAGE_SIZE) {
+        ::close(fd);
+        throw BufferError("not a shared ringbuffer");
+    }
+    size_t bytes = (size_t) st.st_size - PAGE_SIZE;
+    control = mapShared(fd, bytes);
+    // the mapping keeps the memory alive
+    ::close(fd);
+    if (control == nullptr) {
+        throw BufferError(std::string("unable to map shared memory: ") + strerror(errno));
+    }
+    if (control->magic != SHARED_RINGBUFFER_MAGIC || control->elementSize != sizeof(T) || control->size * sizeof(T) != bytes) {
+        unmapShared(control, bytes);
+        throw BufferError("shared ringbuffer does not match the expected data type");
+    }
+    pid_t none = 0;
+    if (!control->readerPid.compare_exchange_strong(none, ::getpid())) {
+        unmapShared(control, bytes);
+        throw BufferError("shared ringbuffer already has a reader");
+    }
+    size = control->size;
+    data = (T*) ((unsigned char*) control + PAGE_SIZE);
+}
+
+template <typename T>
+SharedRingbufferReader<T>::~SharedRingbufferReader() {
+    if (watcher.joinable()) {
+        watching.store(false);
+        futex_wake(&control->written);
+        watcher.join();
+    }
+    // lets the writer go on without us
+    control->detached.store(1);
+    control->consumed.fetch_add(1);
+    futex_wake(&control->consumed);
+    unmapShared(control, size * sizeof(T));
+}
+
+template <typename T>
+size_t SharedRingbufferReader<T>::available() {
+    return control->write_count.load(std::memory_order_acquire) - control->read_count.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+T* SharedRingbufferReader<T>::getReadPointer() {
+    return data + control->read_count.load(std::memory_order_relaxed) % size;
+}
+
+template <typename T>
+void SharedRingbufferReader<T>::advance(size_t how_much) {
+    control->read_count.store(control->read_count.load(std::memory_order_relaxed) + how_much, std::memory_order_release);
+    control->consumed.fetch_add(1);
+    if (control->writerSleeping.load()) futex_wake(&control->consumed);
+}
+
+template <typename T>
+void SharedRingbufferReader<T>::wait() {
+    while (!unblocked.load() && !isClosed()) {
+        uint32_t current = control->written.load();
+        // like RingbufferReader: if there is enough data already but it did not help, wait for more
+        if (current != seen && available() >= threshold.load(std::memory_order_relaxed)) {
+            seen = current;
+            return;
+        }
+        int rc = sleepOn(&control->written, &control->readerSleeping, current);
+        if (timedOut(rc) && !isAlive(control->writerPid)) writerGone.store(true);
+    }
+}
+
+template <typename T>
+void SharedRingbufferReader<T>::unblock() {
+    unblocked.store(true);
+    futex_wake(&control->written);
+    futex_wake(&control->closed);
+}
+
+template <typename T>
+void SharedRingbufferReader<T>::setListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(listenerMutex);
+    this->listener = std::move(listener);
+    if (this->listener && !watcher.joinable()) {
+        watcher = std::thread([this] {
+            watch(&control->written, &control->readerSleeping, watching, listenerMutex, this->listener);
+        });
+    }
+}
+
+template <typename T>
+void SharedRingbufferReader<T>::setWakeThreshold(size_t threshold) {
+    this->threshold.store(std::max(threshold, (size_t) 1), std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t SharedRingbufferReader<T>::getReadCount() {
+    return control->read_count.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+bool SharedRingbufferReader<T>::isClosed() {
+    return control->closed.load() != 0 || writerGone.load();
+}
+
+template <typename T>
+void SharedRingbufferReader<T>::waitForClose() {
+    while (!unblocked.load() && !isClosed()) {
+        int rc = futex_wait(&control->closed, 0);
+        if (timedOut(rc) && !isAlive(control->writerPid)) writerGone.store(true);
+    }
+}
+
+namespace Csdr {
+    template class SharedRingbuffer<char>;
+    template class SharedRingbuffer<unsigned char>;
+    template class SharedRingbuffer<short>;
+    template class SharedRingbuffer<float>;
+    template class SharedRingbuffer<complex<unsigned char>>;
+    template class SharedRingbuffer<complex<short>>;
+    template class SharedRingbuffer<complex<float>>;
+
+    template class SharedRingbufferReader<char>;
+    template class SharedRingbufferReader<unsigned char>;
+    template class SharedRingbufferReader<short>;
+    template class SharedRingbufferReader<float>;
+    template class SharedRingbufferReader<complex<unsigned char>>;
+    template class SharedRingbufferReader<complex<short>>;
+    template class SharedRingbufferReader<complex<float>>;
+}
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "fmv.h"
 
 #include <cmath>
+#include <chrono>
 
 using namespace Csdr;
 
@@ -61,8 +62,18 @@ void ShiftAddfast::setRate(float rate) {
     output[4 * i + j].q((sin_vals_ ## j) * input[4 * i + j].i() + (cos_vals_ ## j) * input[4 * i + j].q());
 
 void ShiftAddfast::process(complex<float>* input, complex<float>* output) {
+    size_t length = getLength();
+    auto start = std::chrono::steady_clock::now();
     // indirection since FMV on virtual functions does not work...
-    process_fmv(input, output, 1024);
+    process_fmv(input, output, length);
+    if (blockSizePolicy.isAdaptive()) {
+        blockSizePolicy.record(length, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+void ShiftAddfast::setBlockSizePolicy(const BlockSizePolicy& policy) {
+    std::lock_guard<std::mutex> lock(processMutex);
+    blockSizePolicy = policy;
 }
 
 CSDR_TARGET_CLONES
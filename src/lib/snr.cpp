@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "snr.hpp"
+#include "designcache.hpp"
 #include <cstring>
 #include <cmath>
 
@@ -54,12 +55,13 @@ Snr<T>::Snr(size_t length, size_t fftSize, std::function<void(float)> callback)
 
     fftInput  = fftwf_alloc_complex(fftSize);
     fftOutput = fftwf_alloc_complex(fftSize);
-    fftPlan   = fftwf_plan_dft_1d(fftSize, fftInput, fftOutput, FFTW_FORWARD, CSDR_FFTW_FLAGS);
+    fftPlan   = DesignCache::getFftPlan(fftSize, FFTW_FORWARD, CSDR_FFTW_FLAGS);
+
+    this->addPort(&measurements);
 }
 
 template<typename T>
 Snr<T>::~Snr() {
-    fftwf_destroy_plan(fftPlan);
     fftwf_free(fftInput);
     fftwf_free(fftOutput);
 }
@@ -68,7 +70,7 @@ template <typename T>
 bool Snr<T>::canProcess() {
     std::lock_guard<std::mutex> lock(this->processMutex);
     size_t length = this->getLength();
-    return (this->reader->available() > length && this->writer->writeable() > length);
+    return (this->reader->available() > length && this->writer->writeable() > length && measurements.writeable() > 0);
 }
 
 template <typename T>
@@ -85,7 +87,7 @@ void Snr<T>::process() {
       data[j] = input[j] * hamming(j, fftSize);
 
     // Calculate FFT on input buffer
-    fftwf_execute(fftPlan);
+    fftwf_execute_dft(fftPlan, fftInput, fftOutput);
 
     for (avg=snr=0.0, j=0 ; j < fftSize ; ++j) {
         float v = fftOutput[j][0]*fftOutput[j][0] + fftOutput[j][1]*fftOutput[j][1];
@@ -99,6 +101,7 @@ void Snr<T>::process() {
 
     // Report peak power over average
     if (callback) callback(snr);
+    measurements.write(snr);
 
     // Pass data
     forwardData(input, snr);
@@ -92,7 +92,7 @@ void TcpSource<T>::loop() {
         } else if (pfd.revents & POLLERR) {
             run = false;
         } else if (pfd.revents & POLLIN) {
-            available = std::min(this->writer->writeable(), (size_t) 1024) * sizeof(T) - offset;
+            available = std::min(this->writer->writeable(), blockSize.load()) * sizeof(T) - offset;
             read_bytes = recv(sock, ((char*) this->writer->getWritePointer()) + offset, available, 0);
             if (read_bytes <= 0) {
                 run = false;
@@ -104,6 +104,11 @@ void TcpSource<T>::loop() {
     }
 }
 
+template <typename T>
+void TcpSource<T>::setBlockSize(size_t blockSize) {
+    this->blockSize = blockSize;
+}
+
 template <typename T>
 void TcpSource<T>::stop() {
     run = false;
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "sstv.hpp"
+#include "designcache.hpp"
 #include <cmath>
 #include <cstring>
 #include <cstdarg>
@@ -97,7 +98,10 @@ SstvDecoder<T>::SstvDecoder(unsigned int sampleRate, unsigned int dbgTime)
     // (wndSize*2 must be large enough for everyting!)
     fftIn     = new float[wndSize*2];
     fftOut    = new fftwf_complex[wndSize*2];
-    fftHeader = fftwf_plan_dft_r2c_1d(wndSize, fftIn, fftOut, FFTW_ESTIMATE);
+    {
+        std::lock_guard<std::mutex> lock(DesignCache::plannerMutex());
+        fftHeader = fftwf_plan_dft_r2c_1d(wndSize, fftIn, fftOut, FFTW_ESTIMATE);
+    }
 
     // Create and map SSTV mode definitions, by VIS
     memset(modes, 0, sizeof(modes));
@@ -139,7 +143,10 @@ SstvDecoder<T>::~SstvDecoder() {
     for(int j=0 ; j<128 ; ++j)
         if(modes[j]) delete modes[j];
 
-    fftwf_destroy_plan(fftHeader);
+    {
+        std::lock_guard<std::mutex> lock(DesignCache::plannerMutex());
+        fftwf_destroy_plan(fftHeader);
+    }
     fftwf_free(fftIn);
     fftwf_free(fftOut);
 }
@@ -775,6 +782,7 @@ bool SstvDecoder<T>::writeData(const void *buf, unsigned int size)
 void SstvMode::destroyPlans()
 {
     // Destroy current plans if any
+    std::lock_guard<std::mutex> lock(DesignCache::plannerMutex());
     if(fftSync)  { fftwf_destroy_plan(fftSync);fftSync=0; }
     if(fftPixel) { fftwf_destroy_plan(fftPixel);fftPixel=0; }
     if(fftHalfp) { fftwf_destroy_plan(fftHalfp);fftHalfp=0; }
@@ -801,6 +809,7 @@ void SstvMode::createPlans(unsigned int rate, fftwf_complex *out, float *in)
     halfpSize = round(HALF_PIXEL_TIME * WINDOW_FACTOR * rate);
 
     // Generate new FFT plans
+    std::lock_guard<std::mutex> lock(DesignCache::plannerMutex());
     fftSync  = fftwf_plan_dft_r2c_1d(syncSize, in, out, FFTW_ESTIMATE);
     fftPixel = fftwf_plan_dft_r2c_1d(pixelSize, in, out, FFTW_ESTIMATE);
     fftHalfp = fftwf_plan_dft_r2c_1d(halfpSize, in, out, FFTW_ESTIMATE);
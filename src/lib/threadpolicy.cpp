@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2023 Jakob Ketterl <jakob.ketterl@gmx.de>
+
+This file is part of libcsdr.
+
+libcsdr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+libcsdr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "threadpolicy.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Csdr;
+
+void ThreadPolicy::setCpus(std::vector<unsigned int> cpus) {
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    this->cpus = std::move(cpus);
+}
+
+const std::vector<unsigned int>& ThreadPolicy::getCpus() const {
+    return cpus;
+}
+
+void ThreadPolicy::setScheduler(int scheduler, int priority) {
+    this->scheduler = scheduler;
+    this->priority = priority;
+}
+
+int ThreadPolicy::getScheduler() const {
+    return scheduler;
+}
+
+int ThreadPolicy::getPriority() const {
+    return priority;
+}
+
+bool ThreadPolicy::isDefault() const {
+    return cpus.empty() && scheduler == SCHED_OTHER;
+}
+
+bool ThreadPolicy::apply() const {
+    bool success = true;
+
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (r != 0) {
+            std::cerr << "ThreadPolicy: could not set CPU affinity: " << strerror(r) << "\n";
+            success = false;
+        }
+    }
+
+    if (scheduler != SCHED_OTHER) {
+        struct sched_param param = {};
+        param.sched_priority = std::max(sched_get_priority_min(scheduler), std::min(priority, sched_get_priority_max(scheduler)));
+        int r = pthread_setschedparam(pthread_self(), scheduler, &param);
+        if (r != 0) {
+            // typically EPERM, unless the process has CAP_SYS_NICE or a suitable RLIMIT_RTPRIO
+            std::cerr << "ThreadPolicy: could not set realtime scheduling: " << strerror(r) << "\n";
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+bool ThreadPolicy::operator==(const ThreadPolicy& other) const {
+    return cpus == other.cpus && scheduler == other.scheduler && priority == other.priority;
+}
+
+bool ThreadPolicy::operator!=(const ThreadPolicy& other) const {
+    return !(*this == other);
+}
+
+std::vector<unsigned int> ThreadPolicy::parseCpus(const std::string& cpus) {
+    std::vector<unsigned int> result;
+    std::stringstream ss(cpus);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        unsigned int first, last;
+        char dash;
+        std::stringstream rs(range);
+        if (!(rs >> first)) {
+            throw std::invalid_argument("invalid CPU list: \"" + cpus + "\"");
+        }
+        last = first;
+        if (rs >> dash) {
+            if (dash != '-' || !(rs >> last) || last < first) {
+                throw std::invalid_argument("invalid CPU range: \"" + range + "\"");
+            }
+        }
+        if (rs >> dash) {
+            throw std::invalid_argument("invalid CPU range: \"" + range + "\"");
+        }
+        if (last >= CPU_SETSIZE) {
+            throw std::invalid_argument("CPU number out of range: \"" + range + "\"");
+        }
+        for (unsigned int cpu = first; cpu <= last; cpu++) result.push_back(cpu);
+    }
+    if (result.empty()) {
+        throw std::invalid_argument("empty CPU list");
+    }
+    return result;
+}
+
+int ThreadPolicy::parseScheduler(const std::string& scheduler) {
+    if (scheduler == "other") return SCHED_OTHER;
+    if (scheduler == "fifo") return SCHED_FIFO;
+    if (scheduler == "rr") return SCHED_RR;
+    throw std::invalid_argument("unknown scheduling policy: \"" + scheduler + "\"");
+}
+
+bool ThreadPolicy::lockMemory() {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        // most likely RLIMIT_MEMLOCK is too low
+        std::cerr << "ThreadPolicy: could not lock memory: " << strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
@@ -21,15 +21,20 @@ along with libcsdr.  If not, see <https://www.gnu.org/licenses/>.
 #include "complex.hpp"
 
 #include <unistd.h>
+#include <cerrno>
 
 using namespace Csdr;
 
 template <typename T>
-StdoutWriter<T>::StdoutWriter(size_t buffer_size):
+StdoutWriter<T>::StdoutWriter(int fd, size_t buffer_size):
+    fd(fd),
     buffer_size(buffer_size),
     buffer((T*) malloc(sizeof(T) * buffer_size))
 {}
 
+template <typename T>
+StdoutWriter<T>::StdoutWriter(size_t buffer_size): StdoutWriter(fileno(stdout), buffer_size) {}
+
 template <typename T>
 StdoutWriter<T>::StdoutWriter(): StdoutWriter(10240) {}
 
@@ -50,7 +55,30 @@ T* StdoutWriter<T>::getWritePointer() {
 
 template <typename T>
 void StdoutWriter<T>::advance(size_t how_much) {
-    write(fileno(stdout), (const char*) buffer, sizeof(T) * how_much);
+    auto data = (const char*) buffer;
+    size_t bytes = sizeof(T) * how_much;
+    while (bytes > 0 && !closed.load(std::memory_order_relaxed)) {
+        ssize_t written = write(fd, data, bytes);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            // the consumer is gone (EPIPE with SIGPIPE ignored). the output is discarded from now on.
+            closed.store(true);
+            break;
+        }
+        data += written;
+        bytes -= written;
+    }
+    write_count.store(write_count.load(std::memory_order_relaxed) + how_much, std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t StdoutWriter<T>::getWriteCount() {
+    return write_count.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+bool StdoutWriter<T>::isClosed() {
+    return closed.load();
 }
 
 template<typename T>
@@ -77,6 +105,16 @@ T* VoidWriter<T>::getWritePointer() {
     return data;
 }
 
+template <typename T>
+void VoidWriter<T>::advance(size_t how_much) {
+    write_count.store(write_count.load(std::memory_order_relaxed) + how_much, std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t VoidWriter<T>::getWriteCount() {
+    return write_count.load(std::memory_order_relaxed);
+}
+
 namespace Csdr {
     template class StdoutWriter<char>;
     template class StdoutWriter<unsigned char>;